@@ -21,12 +21,17 @@ File description:
     Advanced settings dialog implementation.
 */
 
+#include "adv_settings_wnd.h"
 #include "appconfig.h"
+#include "logging.h"
+#include "math_utils/convolution.h"
 
+#include <wx/button.h>
 #include <wx/checkbox.h>
 #include <wx/dialog.h>
 #include <wx/sizer.h>
 #include <wx/stattext.h>
+#include <wx/tokenzr.h>
 
 constexpr int BORDER = 5; ///< Border size (in pixels between) controls
 
@@ -34,9 +39,12 @@ class c_AdvancedSettingsDialog: public wxDialog
 {
     void InitControls();
 
+    void UpdateConvolutionInfo();
+
     struct
     {
         wxCheckBox* normalizeFits{nullptr};
+        wxStaticText* convolutionInfo{nullptr};
     } m_Ctrls;
 
 public:
@@ -75,6 +83,19 @@ void c_AdvancedSettingsDialog::InitControls()
         0, wxALIGN_CENTER_VERTICAL | wxALL, BORDER
     );
 
+    m_Ctrls.convolutionInfo = new wxStaticText(this, wxID_ANY, wxEmptyString);
+    UpdateConvolutionInfo();
+    szTop->Add(m_Ctrls.convolutionInfo, 0, wxALIGN_CENTER_VERTICAL | wxALL, BORDER);
+
+    auto* btnCalibrate = new wxButton(this, wxID_ANY, _("Calibrate convolution"));
+    btnCalibrate->SetToolTip(_("Repeats the measurements when images are processed next time."));
+    btnCalibrate->Bind(wxEVT_BUTTON, [this](wxCommandEvent&)
+    {
+        InitConvolutionCalibration(true);
+        UpdateConvolutionInfo();
+    });
+    szTop->Add(btnCalibrate, 0, wxALIGN_LEFT | wxALL, BORDER);
+
     szTop->AddStretchSpacer();
 
     szTop->Add(CreateSeparatedButtonSizer(wxOK | wxCANCEL), 0, wxGROW | wxALL, BORDER);
@@ -83,6 +104,22 @@ void c_AdvancedSettingsDialog::InitControls()
     Fit();
 }
 
+void c_AdvancedSettingsDialog::UpdateConvolutionInfo()
+{
+    wxString label = wxString::Format(
+        _("Recursive Gaussian convolution is used for kernel radius of at least (as measured for %d thread(s)):"),
+        GetConvolutionNumThreads()
+    );
+    for (int sizeClass = 0; sizeClass < NUM_CONVOLUTION_SIZE_CLASSES; sizeClass++)
+    {
+        const int size = CONVOLUTION_CALIBRATION_IMAGE_SIZES[sizeClass];
+        const int radius = GetYoungVanVlietMinKernelRadius(sizeClass);
+        label += wxString::Format("\n%dx%d: ", size, size) +
+            ((radius > 0) ? wxString::Format(_("%d pixels"), radius) : _("not measured yet"));
+    }
+    m_Ctrls.convolutionInfo->SetLabel(label);
+}
+
 void ShowAdvancedSettingsDialog(wxWindow* parent)
 {
     c_AdvancedSettingsDialog dlg{parent};
@@ -91,3 +128,37 @@ void ShowAdvancedSettingsDialog(wxWindow* parent)
         dlg.SaveSettings();
     }
 }
+
+void InitConvolutionCalibration(bool recalibrate)
+{
+    const bool useStored = !recalibrate && Configuration::ConvolutionCalibrationNumThreads == GetConvolutionNumThreads();
+
+    wxStringTokenizer storedRadii(Configuration::ConvolutionYvVMinKernelRadii, " ");
+    for (int sizeClass = 0; sizeClass < NUM_CONVOLUTION_SIZE_CLASSES; sizeClass++)
+    {
+        long radius = 0;
+        if (!useStored ||
+            !storedRadii.HasMoreTokens() ||
+            !storedRadii.GetNextToken().ToLong(&radius) ||
+            radius < CONVOLUTION_CALIBRATION_MIN_KERNEL_RADIUS)
+        {
+            radius = 0; // calibrate when first needed
+        }
+        SetYoungVanVlietMinKernelRadius(sizeClass, static_cast<int>(radius));
+    }
+}
+
+void StoreConvolutionCalibration()
+{
+    wxString radii;
+    for (int sizeClass = 0; sizeClass < NUM_CONVOLUTION_SIZE_CLASSES; sizeClass++)
+    {
+        if (sizeClass > 0)
+            radii += " ";
+        radii += wxString::Format("%d", GetYoungVanVlietMinKernelRadius(sizeClass));
+    }
+
+    Log::Print(wxString::Format("Min. kernel radii for recursive convolution: %s\n", radii));
+    Configuration::ConvolutionYvVMinKernelRadii = radii;
+    Configuration::ConvolutionCalibrationNumThreads = GetConvolutionNumThreads();
+}
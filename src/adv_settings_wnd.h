@@ -28,4 +28,12 @@ File description:
 
 void ShowAdvancedSettingsDialog(wxWindow* parent);
 
+/// Sets up the selection of convolution method using the calibration results stored in configuration.
+/** Image size classes without a stored result (or all of them, if the results were determined for a different
+    number of threads, or if 'recalibrate' is true) are calibrated when first needed, on a processing thread. */
+void InitConvolutionCalibration(bool recalibrate);
+
+/// Stores the current convolution calibration results in configuration.
+void StoreConvolutionCalibration();
+
 #endif // IMPPG_ADV_SETTINGS_DIALOG_HEADER
@@ -90,6 +90,9 @@ namespace Keys
     const char* BatchDialogPosSize          = UserInterfaceGroup"/BatchDlgPosSize";
     const char* BatchProgressDialogPosSize  = UserInterfaceGroup"/BatchProgressDlgPosSize";
     const char* BatchOutputFormat           = UserInterfaceGroup"/BatchOutputFormat";
+    const char* BatchLRWarmStart            = UserInterfaceGroup"/BatchLRWarmStart";
+    const char* BatchLRWarmStartIterations  = UserInterfaceGroup"/BatchLRWarmStartIterations";
+    const char* BatchLRWarmStartKeyframeInterval = UserInterfaceGroup"/BatchLRWarmStartKeyframeInterval";
 
 
     const char* AlignInputPath              = UserInterfaceGroup"/AlignInputPath";
@@ -120,6 +123,11 @@ namespace Keys
     const char* OpenGLInitIncomplete = OpenGLGroup"/OpenGLInitIncomplete";
 
     const char* NormalizeFITSValues = "/NormalizeFITSValues";
+
+#define ConvolutionGroup "/Convolution"
+
+    const char* ConvolutionYvVMinKernelRadii = ConvolutionGroup"/YvVMinKernelRadii";
+    const char* ConvolutionCalibrationNumThreads = ConvolutionGroup"/CalibrationNumThreads";
 }
 
 void Initialize(wxFileConfig* _appConfig)
@@ -173,6 +181,8 @@ PROPERTY_BOOL(LogHistogram, true);
 
 PROPERTY_BOOL(OpenGLInitIncomplete, false);
 
+PROPERTY_BOOL(BatchLRWarmStart, false);
+
 // Finds and uses wxFromString() and wxToString() defined above
 #define PROPERTY_RECT(Name)                                               \
     c_Property<wxRect> Name(                                              \
@@ -285,6 +295,8 @@ PROPERTY_UNSIGNED(ToneCurveEditor_CurvePointSize, 4);
 PROPERTY_INT(ProcessingPanelWidth, -1);
 PROPERTY_UNSIGNED(ToolIconSize, DEFAULT_TOOL_ICON_SIZE);
 PROPERTY_UNSIGNED(ToneCurveEditorNumDrawSegments, DEFAULT_TONE_CURVE_EDITOR_NUM_DRAW_SEGMENTS);
+PROPERTY_UNSIGNED(BatchLRWarmStartIterations, 10);
+PROPERTY_UNSIGNED(BatchLRWarmStartKeyframeInterval, 10);
 PROPERTY_INT(FileInputFormatIndex, 0);
 
 /// Returns a list of the most recently used saved/loaded settings files
@@ -332,4 +344,7 @@ c_Property<ScalingMethod> DisplayScalingMethod(
 
 PROPERTY_BOOL(NormalizeFITSValues, true);
 
+PROPERTY_STRING(ConvolutionYvVMinKernelRadii);
+PROPERTY_INT(ConvolutionCalibrationNumThreads, 0);
+
 }  // namespace Configuration
@@ -71,6 +71,10 @@ namespace Configuration
     extern c_Property<wxString> BatchOutputPath;
     extern c_Property<wxRect>   BatchDialogPosSize;
     extern c_Property<wxRect>   BatchProgressDialogPosSize;
+    /// If true, L-R deconvolution of batch-processed images starts from the previous image's result.
+    extern c_Property<bool>     BatchLRWarmStart;
+    extern c_Property<unsigned> BatchLRWarmStartIterations;
+    extern c_Property<unsigned> BatchLRWarmStartKeyframeInterval;
     extern c_Property<wxRect>   AlignProgressDialogPosSize;
     extern c_Property<wxString> AlignInputPath;
     extern c_Property<wxString> AlignOutputPath;
@@ -111,6 +115,12 @@ namespace Configuration
     /// responsiveness of the L-R controls (i.e. each change of L-R parameters will block the GUI for
     /// a noticeable moment - a time it takes for the OpenGL command batch to complete).
     extern c_Property<unsigned> LRCmdBatchSizeMpixIters;
+
+    /// Results of the convolution calibration (see `CalibrateYoungVanVlietMinKernelRadius`), separated with spaces;
+    /// one value per image size class (0 if not performed yet).
+    extern c_Property<wxString> ConvolutionYvVMinKernelRadii;
+    /// Number of threads for which `ConvolutionYvVMinKernelRadii` have been determined.
+    extern c_Property<int> ConvolutionCalibrationNumThreads;
 }
 
 #endif
@@ -38,7 +38,19 @@ namespace imppg::backend {
 enum class CompletionStatus
 {
     COMPLETED = 0,
-    ABORTED
+    ABORTED,
+    FAILED ///< Processing could not be performed (e.g. a measured PSF could not be loaded); the reason is reported via the progress text.
+};
+
+/// Settings of warm-started L-R deconvolution of image sequences (e.g. frames of an aligned time-lapse).
+struct LRWarmStartSettings
+{
+    /// Number of L-R iterations performed on an image starting from the previous image's result.
+    int iterations{10};
+
+    /// Every this many images, the full number of iterations is performed starting from the image itself
+    /// (otherwise the effective number of iterations would keep growing along the sequence).
+    int keyframeInterval{10};
 };
 
 class IDisplayBackEnd
@@ -124,6 +136,11 @@ public:
     /// Shall be called by the main window from "on idle" handler; the back end may call `event.RequestMore()`.
     virtual void OnIdle(wxIdleEvent& event) { (void)event; }
 
+    /// Enables (or disables, if empty) warm-started L-R deconvolution of subsequent images passed to `StartProcessing`.
+    /** The L-R estimate of an image starts from the previous image's result (if it has the same size).
+        Back ends which do not support it ignore the call. */
+    virtual void SetLRWarmStart(std::optional<LRWarmStartSettings> settings) { (void)settings; }
+
     virtual void AbortProcessing() = 0;
 
     virtual ~IProcessingBackEnd() = default;
@@ -517,7 +517,7 @@ c_Image c_CpuAndBitmaps::GetProcessedSelection()
 
     AbortProcessing();
 
-    m_Processor.ApplyPreciseToneCurveValues();
+    m_Processor.CompleteToneMappingOutput();
     return m_Processor.GetToneMappingOutput();
 }
 
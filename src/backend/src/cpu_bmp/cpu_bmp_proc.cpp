@@ -21,6 +21,9 @@ File description:
     CPU & bitmaps processing back end implementation.
 */
 
+#include <algorithm>
+#include <wx/filename.h>
+
 #include "cpu_bmp_proc.h"
 #include "w_lrdeconv.h"
 #include "w_tcurve.h"
@@ -40,9 +43,10 @@ void c_CpuAndBitmapsProcessing::StartProcessing(c_Image img, ProcessingSettings
 {
     m_OwnedImg = std::move(img);
     m_Img = &m_OwnedImg.value();
+    m_ImgGeneration++;
+    m_FusePostSharpening = true;
     SetSelection(m_OwnedImg.value().GetImageRect());
     m_ProcSettings = procSettings;
-    m_UsePreciseToneCurveValues = true;
 
     ScheduleProcessing(ProcessingRequest::SHARPENING);
 }
@@ -189,6 +193,15 @@ void c_CpuAndBitmapsProcessing::OnProcessingStepCompleted(CompletionStatus statu
             m_Output.sharpening.valid = true;
             ScheduleProcessing(ProcessingRequest::UNSHARP_MASKING);
         }
+        else if (m_ProcessingRequest == ProcessingRequest::UNSHARP_MASKING && m_UnshMaskIncludesToneCurve)
+        {
+            m_Output.toneCurve.valid = true;
+
+            if (m_OnProcessingCompleted)
+            {
+                m_OnProcessingCompleted(status);
+            }
+        }
         else if (m_ProcessingRequest == ProcessingRequest::UNSHARP_MASKING)
         {
             m_Output.unsharpMasking.valid = true;
@@ -204,14 +217,97 @@ void c_CpuAndBitmapsProcessing::OnProcessingStepCompleted(CompletionStatus statu
             }
         }
     }
+    else if (status == CompletionStatus::FAILED)
+    {
+        Log::Print("Processing step failed\n");
+
+        if (m_ProgressTextHandler)
+        {
+            m_ProgressTextHandler(m_LRMeasuredPsfError);
+        }
+
+        if (m_OnProcessingCompleted)
+        {
+            m_OnProcessingCompleted(status);
+        }
+    }
     else if (status == CompletionStatus::ABORTED && m_OnProcessingCompleted)
     {
         m_OnProcessingCompleted(status);
     }
 }
 
+void c_CpuAndBitmapsProcessing::SetLRWarmStart(std::optional<LRWarmStartSettings> settings)
+{
+    IMPPG_ASSERT(!settings.has_value() || (settings->iterations > 0 && settings->keyframeInterval > 0));
+    m_LRWarmStart = settings;
+    m_LRWarmStartEstimate = std::nullopt;
+    m_NumLRWarmStarts = 0;
+}
+
+c_CpuAndBitmapsProcessing::LRResultKey c_CpuAndBitmapsProcessing::GetLRResultKey() const
+{
+    const auto& settings = m_ProcSettings.LucyRichardson;
+
+    return LRResultKey{
+        m_ImgGeneration,
+        m_Selection,
+        settings.sigma,
+        settings.iterations,
+        settings.accelerated,
+        settings.convergenceStop.enabled ? settings.convergenceStop.tolerance : 0.0f,
+        settings.deringing.enabled,
+        settings.measuredPsf.enabled ? settings.measuredPsf.fileName : std::string{}
+    };
+}
+
 void c_CpuAndBitmapsProcessing::StartLRDeconvolution()
 {
+    // Sharpening settings may have been "changed" without affecting the result (e.g. by changing them back
+    // before the previous request has been processed); if so, keep the result and only run the subsequent steps
+    LRResultKey resultKey = GetLRResultKey();
+    if (m_Output.sharpening.valid && m_Output.sharpening.img.has_value() && resultKey == m_LRResultKey)
+    {
+        Log::Print("L-R deconvolution result is up to date, no work needed\n");
+        OnProcessingStepCompleted(CompletionStatus::COMPLETED);
+        return;
+    }
+
+    // Do not silently fall back to the Gaussian PSF, as the results would be different than requested
+    if (m_ProcSettings.LucyRichardson.iterations > 0 && !PrepareLRMeasuredPsf())
+    {
+        m_Output.sharpening.valid = false;
+        m_Output.unsharpMasking.valid = false;
+        m_Output.toneCurve.valid = false;
+        m_LRResultKey = {};
+        OnProcessingStepCompleted(CompletionStatus::FAILED);
+        return;
+    }
+    m_LRResultKey = std::move(resultKey);
+    m_SharpeningGeneration++;
+
+    // When warm-starting, keep the previous image's L-R result as the initial estimate
+    // (the previously kept estimate's buffer is reused for the new output below)
+    bool warmStart = false;
+    if (m_LRWarmStart.has_value() && m_ProcSettings.LucyRichardson.iterations > 0)
+    {
+        const auto& prevResult = m_Output.sharpening.img;
+        warmStart = m_Output.sharpening.valid && prevResult.has_value() &&
+            static_cast<int>(prevResult->GetWidth()) == m_Selection.width &&
+            static_cast<int>(prevResult->GetHeight()) == m_Selection.height &&
+            m_NumLRWarmStarts + 1 < m_LRWarmStart->keyframeInterval;
+
+        if (warmStart)
+        {
+            std::swap(m_LRWarmStartEstimate, m_Output.sharpening.img);
+            m_NumLRWarmStarts++;
+        }
+        else
+        {
+            m_NumLRWarmStarts = 0;
+        }
+    }
+
     auto& img = m_Output.sharpening.img;
     if (!img.has_value() ||
         static_cast<int>(img->GetWidth()) != m_Selection.width ||
@@ -245,6 +341,24 @@ void c_CpuAndBitmapsProcessing::StartLRDeconvolution()
         Log::Print(wxString::Format("Launching L-R deconvolution worker thread (id = %d)\n",
                 m_CurrentThreadId));
 
+        // If only the number of iterations has changed since the last run, resume from its estimates
+        const LRResumeKey resumeKey{m_ImgGeneration, m_Selection, m_ProcSettings.LucyRichardson.sigma, m_ProcSettings.LucyRichardson.deringing.enabled};
+        if (!(resumeKey == m_LRResumeKey))
+        {
+            m_LRResumable.Clear();
+            m_LRResumeKey = resumeKey;
+        }
+
+        const int numIterations = warmStart
+            ? std::min(m_LRWarmStart->iterations, m_ProcSettings.LucyRichardson.iterations)
+            : m_ProcSettings.LucyRichardson.iterations;
+        if (warmStart)
+        {
+            Log::Print(wxString::Format("Warm-starting L-R deconvolution from the previous image's result (%d iterations)\n", numIterations));
+        }
+
+        const c_Image* measuredPsf = GetLRMeasuredPsf();
+
         // Sharpening thread takes the currently selected fragment of the original image as input
         m_ProcRequestInProgress = ProcessingRequest::SHARPENING;
         m_Worker = std::make_unique<c_LucyRichardsonThread>(
@@ -262,10 +376,22 @@ void c_CpuAndBitmapsProcessing::StartLRDeconvolution()
                 m_CurrentThreadId
             },
             m_ProcSettings.LucyRichardson.sigma,
-            m_ProcSettings.LucyRichardson.iterations,
+            numIterations,
+            m_ProcSettings.LucyRichardson.accelerated,
+            m_ProcSettings.LucyRichardson.convergenceStop.enabled ? m_ProcSettings.LucyRichardson.convergenceStop.tolerance : 0.0f,
             m_ProcSettings.LucyRichardson.deringing.enabled,
             DERINGING_BRIGHTNESS_THRESHOLD, m_ProcSettings.LucyRichardson.sigma,
-            m_DeringingWorkBuf
+            m_DeringingWorkBuf,
+            m_DeringingConvPlan,
+            m_LRConvPlan,
+            m_LRWorkspace,
+            measuredPsf,
+            m_LRPsfConv,
+            // every image is new when warm-starting; the stored estimates are only for the Gaussian PSF
+            (m_LRWarmStart.has_value() || measuredPsf) ? nullptr : &m_LRResumable,
+            warmStart
+                ? std::optional<c_View<const IImageBuffer>>(c_View<const IImageBuffer>(m_LRWarmStartEstimate->GetBuffer()))
+                : std::nullopt
         );
 
         if (m_ProgressTextHandler)
@@ -277,9 +403,71 @@ void c_CpuAndBitmapsProcessing::StartLRDeconvolution()
     }
 }
 
+bool c_CpuAndBitmapsProcessing::PrepareLRMeasuredPsf()
+{
+    const auto& settings = m_ProcSettings.LucyRichardson.measuredPsf;
+    if (!settings.enabled)
+    {
+        return true;
+    }
+
+    if (settings.fileName.empty())
+    {
+        m_LRMeasuredPsfFileName.clear();
+        m_LRMeasuredPsf = std::nullopt;
+        m_LRMeasuredPsfError = _("No PSF file has been selected.");
+    }
+    else if (settings.fileName != m_LRMeasuredPsfFileName)
+    {
+        m_LRMeasuredPsfFileName = settings.fileName;
+        m_LRMeasuredPsf = std::nullopt;
+
+        // FITS values can be normalized, as the PSF's sum is normalized anyway
+        std::string errorMsg;
+        const auto loadResult = LoadImageFileAsMono32f(
+            settings.fileName,
+            wxFileName(wxString::FromUTF8(settings.fileName)).GetExt().Lower().ToStdString(),
+            true,
+            &errorMsg
+        );
+        wxString reason = wxString::FromUTF8(errorMsg);
+        if (loadResult.has_value())
+        {
+            m_LRMeasuredPsf = PreparePSF(loadResult.value());
+            reason = _("The image is flat.");
+        }
+
+        if (m_LRMeasuredPsf.has_value())
+        {
+            Log::Print(wxString::Format("Loaded measured PSF %s (%ux%u)\n", wxString::FromUTF8(settings.fileName),
+                m_LRMeasuredPsf->GetWidth(), m_LRMeasuredPsf->GetHeight()));
+        }
+        else
+        {
+            m_LRMeasuredPsfError = wxString::Format(_("Could not use %s as the PSF."), wxString::FromUTF8(settings.fileName))
+                + " " + reason;
+        }
+    }
+
+    if (!m_LRMeasuredPsf.has_value())
+    {
+        Log::Print(m_LRMeasuredPsfError + "\n");
+        return false;
+    }
+
+    return true;
+}
+
+const c_Image* c_CpuAndBitmapsProcessing::GetLRMeasuredPsf() const
+{
+    return (m_ProcSettings.LucyRichardson.measuredPsf.enabled && m_LRMeasuredPsf.has_value()) ? &m_LRMeasuredPsf.value() : nullptr;
+}
+
 void c_CpuAndBitmapsProcessing::StartUnsharpMasking()
 {
-    auto& img = m_Output.unsharpMasking.img;
+    m_UnshMaskIncludesToneCurve = m_FusePostSharpening && m_ProcSettings.unsharpMasking.IsEffective();
+
+    auto& img = m_UnshMaskIncludesToneCurve ? m_Output.toneCurve.img : m_Output.unsharpMasking.img;
     if (!img.has_value() ||
         static_cast<int>(img->GetWidth()) != m_Selection.width ||
         static_cast<int>(img->GetHeight()) != m_Selection.height)
@@ -305,6 +493,22 @@ void c_CpuAndBitmapsProcessing::StartUnsharpMasking()
         Log::Print(wxString::Format("Launching unsharp masking worker thread (id = %d)\n",
             m_CurrentThreadId));
 
+        // The blurred input depends only on the sharpening output and sigma, and the blurred raw input
+        // only on the selection, so they are kept between runs (e.g. when only the amount changes)
+        const UnshMaskBlurKey blurKey{m_SharpeningGeneration, m_ProcSettings.unsharpMasking.sigma};
+        const bool blurValid = (blurKey == m_UnshMaskBlurKey);
+        m_UnshMaskBlurKey = blurKey;
+
+        const SteeringBlurKey steeringKey{m_ImgGeneration, m_Selection};
+        const bool steeringValid = (steeringKey == m_SteeringBlurKey);
+        if (m_ProcSettings.unsharpMasking.adaptive)
+        {
+            m_SteeringBlurKey = steeringKey;
+        }
+
+        Log::Print(wxString::Format("Reusing blurred input: %s, blurred raw input: %s\n",
+            blurValid ? "yes" : "no", steeringValid ? "yes" : "no"));
+
         // unsharp masking thread takes the output of sharpening as input
         m_ProcRequestInProgress = ProcessingRequest::UNSHARP_MASKING;
         m_Worker = std::make_unique<c_UnsharpMaskingThread>(
@@ -312,7 +516,7 @@ void c_CpuAndBitmapsProcessing::StartUnsharpMasking()
                 m_EvtHandler,
                 0, // in the future we will pass the index of currently open image
                 m_Output.sharpening.img.value().GetBuffer(),
-                m_Output.unsharpMasking.img.value().GetBuffer(),
+                img.value().GetBuffer(),
                 m_CurrentThreadId
             },
             c_View<const IImageBuffer>(m_Img->GetBuffer(), m_Selection),
@@ -321,7 +525,15 @@ void c_CpuAndBitmapsProcessing::StartUnsharpMasking()
             m_ProcSettings.unsharpMasking.amountMin,
             m_ProcSettings.unsharpMasking.amountMax,
             m_ProcSettings.unsharpMasking.threshold,
-            m_ProcSettings.unsharpMasking.width
+            m_ProcSettings.unsharpMasking.width,
+            m_UnshMaskConvPlan,
+            m_UnshMaskBlurBuf,
+            blurValid,
+            m_SteeringBlurBuf,
+            steeringValid,
+            (m_UnshMaskIncludesToneCurve && !m_ProcSettings.toneCurve.IsIdentity())
+                ? std::optional<c_ToneCurve>(m_ProcSettings.toneCurve)
+                : std::nullopt
         );
 
         if (m_ProgressTextHandler)
@@ -370,6 +582,12 @@ void c_CpuAndBitmapsProcessing::StartToneCurve()
         Log::Print(wxString::Format("Launching tone curve worker thread (id = %d)\n",
                 m_CurrentThreadId));
 
+        // The LUT is recalculated by the worker only if the curve's shape has changed
+        if (!m_ToneCurveWithLut.HasSameShape(m_ProcSettings.toneCurve))
+        {
+            m_ToneCurveWithLut = m_ProcSettings.toneCurve;
+        }
+
         // tone curve thread takes the output of unsharp masking as input
         m_ProcRequestInProgress = ProcessingRequest::TONE_CURVE;
         m_Worker = std::make_unique<c_ToneCurveThread>(
@@ -380,8 +598,7 @@ void c_CpuAndBitmapsProcessing::StartToneCurve()
                 m_Output.toneCurve.img.value().GetBuffer(),
                 m_CurrentThreadId
             },
-            m_ProcSettings.toneCurve,
-            m_UsePreciseToneCurveValues
+            m_ToneCurveWithLut
         );
 
         if (m_ProgressTextHandler)
@@ -450,11 +667,12 @@ void c_CpuAndBitmapsProcessing::AbortProcessing()
     }
 }
 
-void c_CpuAndBitmapsProcessing::ApplyPreciseToneCurveValues()
+void c_CpuAndBitmapsProcessing::CompleteToneMappingOutput()
 {
     IMPPG_ASSERT(!IsProcessingInProgress());
 
-    if (m_Output.toneCurve.preciseValuesApplied)
+    // The LUT used for tone mapping is precise enough for the saved output, so there is no need to recalculate it
+    if (m_Output.toneCurve.valid)
     {
         return;
     }
@@ -474,35 +692,40 @@ void c_CpuAndBitmapsProcessing::ApplyPreciseToneCurveValues()
         );
     }
 
-    if (!m_Output.toneCurve.valid)
-    {
-        m_Output.toneCurve.img = c_Image(m_Selection.width, m_Selection.height, PixelFormat::PIX_MONO32F);
-        c_Image::Copy(
-            m_Output.unsharpMasking.img.value(),
-            m_Output.toneCurve.img.value(),
-            0,
-            0,
-            m_Selection.width,
-            m_Selection.height,
-            0,
-            0
-        );
-    }
+    m_Output.toneCurve.img = c_Image(m_Selection.width, m_Selection.height, PixelFormat::PIX_MONO32F);
+    c_Image::Copy(
+        m_Output.unsharpMasking.img.value(),
+        m_Output.toneCurve.img.value(),
+        0,
+        0,
+        m_Selection.width,
+        m_Selection.height,
+        0,
+        0
+    );
 
     IMPPG_ASSERT(m_Output.unsharpMasking.img.value().GetImageRect() == m_Output.toneCurve.img.value().GetImageRect());
 
-    c_Image& src = m_Output.unsharpMasking.img.value();
-    c_Image& dest = m_Output.toneCurve.img.value();
-    for (unsigned y = 0; y < src.GetHeight(); ++y)
+    if (!m_ToneCurveWithLut.HasSameShape(m_ProcSettings.toneCurve))
     {
-        m_ProcSettings.toneCurve.ApplyPreciseToneCurve(
-            src.GetRowAs<float>(y),
-            dest.GetRowAs<float>(y),
+        m_ToneCurveWithLut = m_ProcSettings.toneCurve;
+    }
+    if (!m_ToneCurveWithLut.HasLut())
+    {
+        m_ToneCurveWithLut.RefreshLut();
+    }
+
+    const c_TypedView<const float> src(m_Output.unsharpMasking.img.value());
+    const c_TypedView<float> dest(m_Output.toneCurve.img.value());
+    #pragma omp parallel for
+    for (int y = 0; y < src.GetHeight(); ++y)
+    {
+        m_ToneCurveWithLut.ApplyApproximatedToneCurve(
+            src.GetRow(y),
+            dest.GetRow(y),
             src.GetWidth()
         );
     }
-
-    m_Output.toneCurve.preciseValuesApplied = true;
 }
 
 void c_CpuAndBitmapsProcessing::SetSelection(wxRect selection)
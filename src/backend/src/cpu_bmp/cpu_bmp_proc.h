@@ -25,10 +25,14 @@ File description:
 #define IMPPG_CPU_BMP_PROC_HEADER
 
 #include "backend/backend.h"
+#include "cpu_bmp/lrdeconv.h"
 #include "cpu_bmp/worker.h"
+#include "math_utils/convolution.h"
+#include "math_utils/fft_convolution.h"
 #include "../../exclusive_access.h"
 
 #include <functional>
+#include <string>
 
 namespace imppg::backend {
 
@@ -46,6 +50,8 @@ public:
 
     const c_Image& GetProcessedOutput() override;
 
+    void SetLRWarmStart(std::optional<LRWarmStartSettings> settings) override;
+
     void AbortProcessing() override;
 
     // --------------------------------------------------------------------------------------------
@@ -62,7 +68,7 @@ public:
 
     ~c_CpuAndBitmapsProcessing() override;
 
-    void SetImage(c_Image& img) { m_Img = &img; }
+    void SetImage(c_Image& img) { m_Img = &img; m_ImgGeneration++; m_FusePostSharpening = false; }
 
     void SetSelection(wxRect selection);
 
@@ -86,9 +92,9 @@ public:
 
     const c_Image& GetToneMappingOutput() const { return m_Output.toneCurve.img.value(); }
 
-    /// Applies precise tone curve values to unsharp masking output if it is valid; otherwise,
-    /// applies them to (fragment of) original image.
-    void ApplyPreciseToneCurveValues();
+    /// Makes sure the tone mapping output is available: if the last tone curve application has not completed,
+    /// applies the tone curve to unsharp masking output if it is valid; otherwise, to (fragment of) original image.
+    void CompleteToneMappingOutput();
 
     /// Returns `true` if the processing thread is running.
     bool IsProcessingInProgress();
@@ -100,6 +106,13 @@ private:
 
     void StartLRDeconvolution();
 
+    /// Loads the measured PSF to be used by L-R deconvolution if its file name has changed.
+    /** Returns 'false' if a measured PSF is enabled, but cannot be used (see `m_LRMeasuredPsfError`). */
+    bool PrepareLRMeasuredPsf();
+
+    /// Returns the measured PSF to be used by L-R deconvolution, or null if the Gaussian one is to be used.
+    const c_Image* GetLRMeasuredPsf() const;
+
     void StartUnsharpMasking();
 
     void StartToneCurve();
@@ -112,6 +125,8 @@ private:
 
     c_Image* m_Img{nullptr}; ///< Image being processed.
 
+    int m_ImgGeneration{0}; ///< Increased by 1 every time `m_Img` is set.
+
     wxRect m_Selection; ///< Fragment of `m_Img` selected for processing (in logical image coords).
 
     wxEvtHandler m_EvtHandler;
@@ -122,6 +137,125 @@ private:
 
     std::vector<uint8_t> m_DeringingWorkBuf;
 
+    /// Convolution plans kept between processing runs, so that the kernels and scratch buffers are reused.
+    c_ConvolutionPlan m_LRConvPlan;
+    c_ConvolutionPlan m_UnshMaskConvPlan;
+    c_ConvolutionPlan m_DeringingConvPlan;
+
+    /// Working memory of L-R deconvolution kept between processing runs; reallocated only when the selection grows.
+    /** Must not be accessed when the L-R deconvolution thread is running. */
+    LRWorkspace m_LRWorkspace;
+
+    /// Estimates of L-R deconvolution kept for resuming it when only the number of iterations changes.
+    /** Must not be accessed when the L-R deconvolution thread is running. */
+    c_LRResumableEstimate m_LRResumable;
+
+    /// Parameters for which `m_LRResumable` is valid.
+    struct LRResumeKey
+    {
+        int imgGeneration{-1};
+        wxRect selection;
+        float sigma{0.0f};
+        bool deringing{false};
+
+        bool operator==(const LRResumeKey& other) const
+        {
+            return imgGeneration == other.imgGeneration && selection == other.selection &&
+                sigma == other.sigma && deringing == other.deringing;
+        }
+    } m_LRResumeKey;
+
+    /// Parameters (other than the input image) on which the L-R deconvolution result depends.
+    struct LRResultKey
+    {
+        int imgGeneration{-1};
+        wxRect selection;
+        float sigma{0.0f};
+        int iterations{0};
+        bool accelerated{false};
+        float convergenceTolerance{0.0f}; ///< 0 if convergence-based stopping is disabled.
+        bool deringing{false};
+        std::string measuredPsfFileName; ///< Empty if the Gaussian PSF is used.
+
+        bool operator==(const LRResultKey& other) const
+        {
+            return imgGeneration == other.imgGeneration && selection == other.selection &&
+                sigma == other.sigma && iterations == other.iterations && accelerated == other.accelerated &&
+                convergenceTolerance == other.convergenceTolerance && deringing == other.deringing &&
+                measuredPsfFileName == other.measuredPsfFileName;
+        }
+    };
+
+    /// Returns the parameters of L-R deconvolution of the current selection with the current settings.
+    LRResultKey GetLRResultKey() const;
+
+    /// Parameters of the last launched L-R deconvolution; `m_Output.sharpening.img` corresponds to them
+    /// if `m_Output.sharpening.valid` is true, in which case a request with the same parameters is not performed again.
+    LRResultKey m_LRResultKey;
+
+    /// Increased by 1 every time `m_Output.sharpening.img` is (being) overwritten.
+    int m_SharpeningGeneration{0};
+
+    std::optional<LRWarmStartSettings> m_LRWarmStart;
+
+    /// L-R result of the previous image, used as the initial estimate of the current one when warm-starting.
+    /** Must not be accessed when the L-R deconvolution thread is running. */
+    std::optional<c_Image> m_LRWarmStartEstimate;
+
+    /// Number of images warm-started since the last full L-R deconvolution.
+    int m_NumLRWarmStarts{0};
+
+    /// Measured PSF (prepared by `PreparePSF`) and the file it was loaded from; empty if the loading failed.
+    std::optional<c_Image> m_LRMeasuredPsf;
+    std::string m_LRMeasuredPsfFileName;
+    wxString m_LRMeasuredPsfError; ///< Reason why `m_LRMeasuredPsf` could not be loaded.
+
+    /// Frequency-domain convolution with `m_LRMeasuredPsf`; keeps the PSF's spectrum between processing runs.
+    /** Must not be accessed when the L-R deconvolution thread is running. */
+    c_FFTConvolution m_LRPsfConv;
+
+    /// If true (for images provided via `StartProcessing`, i.e. in batch mode), unsharp masking also applies
+    /// the tone curve (in the same pass), writing directly to `m_Output.toneCurve.img`; the intermediate
+    /// unsharp masking output is not kept, as there are no incremental re-runs.
+    bool m_FusePostSharpening{false};
+
+    /// True if the current (or last) unsharp masking run also applies the tone curve.
+    bool m_UnshMaskIncludesToneCurve{false};
+
+    /// Gaussian-blurred input of unsharp masking (i.e. of `m_Output.sharpening.img`).
+    std::vector<float> m_UnshMaskBlurBuf;
+
+    /// Parameters for which `m_UnshMaskBlurBuf` is valid.
+    struct UnshMaskBlurKey
+    {
+        int sharpeningGeneration{-1};
+        float sigma{0.0f};
+
+        bool operator==(const UnshMaskBlurKey& other) const
+        {
+            return sharpeningGeneration == other.sharpeningGeneration && sigma == other.sigma;
+        }
+    } m_UnshMaskBlurKey;
+
+    /// Raw input blurred with sigma = RAW_IMAGE_BLUR_SIGMA_FOR_ADAPTIVE_UNSHARP_MASK; steers adaptive unsharp masking.
+    std::vector<float> m_SteeringBlurBuf;
+
+    /// Parameters for which `m_SteeringBlurBuf` is valid.
+    struct SteeringBlurKey
+    {
+        int imgGeneration{-1};
+        wxRect selection;
+
+        bool operator==(const SteeringBlurKey& other) const
+        {
+            return imgGeneration == other.imgGeneration && selection == other.selection;
+        }
+    } m_SteeringBlurKey;
+
+    /// Tone curve applied by the last tone curve step; keeps its LUT until the curve's shape changes.
+    /** Must not be accessed when the tone curve thread is running. */
+    c_ToneCurve m_ToneCurveWithLut;
+
     std::unique_ptr<IWorkerThread> m_Worker;
 
     /// Identifier increased by 1 after each creation of a new thread
@@ -168,13 +302,10 @@ private:
         {
             std::optional<c_Image> img;
             bool valid{false}; ///< `true` if the last tone curve application request completed.
-            bool preciseValuesApplied{false}; ///< 'true' if precise values of tone curve have been applied; happens only when saving output file.
         } toneCurve;
     } m_Output;
 
     std::function<void(CompletionStatus)> m_OnProcessingCompleted;
-
-    bool m_UsePreciseToneCurveValues{false};
 };
 
 }  // namespace imppg::backend
@@ -26,14 +26,15 @@ File description:
 #include <cmath>
 #include <cstdint>
 #include <cstring>
-#include <memory>
-#include <tuple>
+#include <iterator>
+#include <utility>
 #include <vector>
 
 //#include "imppg_assert.h"
+#include "logging/logging.h"
 #include "lrdeconv.h"
 #include "math_utils/gauss.h"
-
+#include "math_utils/pixel_ops.h"
 
 // NOTE: MSVC 18 requires a signed integral type 'for' loop counter
 //       when using OpenMP
@@ -42,19 +43,315 @@ File description:
 void Clamp(c_View<IImageBuffer>& buf)
 {
     IMPPG_ASSERT(buf.GetPixelFormat() == PixelFormat::PIX_MONO32F);
-    for (unsigned j = 0; j < buf.GetHeight(); j++)
+    ClampArray(ToPaddedArray(c_TypedView<float>(buf)));
+}
+
+/// Performs a single L-R iteration, updating 'buffers.prev' (which must contain the current estimate with its halo filled).
+static void Iterate(
+    c_PaddedArrayPtr<const float> input, ///< Has the same size as 'buffers'
+    LRBuffers& buffers,
+    c_ConvolutionPlan& convPlan ///< Prepared for the size of 'input'
+)
+{
+    // Divide 'input' by the convolved estimate (adding a small epsilon to prevent division by 0 and propagation
+    // of NaNs across output pixels); fused with the final stage of convolution
+    convPlan.Execute(buffers.prev, buffers.estimateConvolved.GetInterior(), ConvolutionEpilogue::DIVIDE_INTO, input);
+    buffers.estimateConvolved.FillHalo();
+
+    // Multiply the previous estimate by the convolved quotient; fused with the final stage of convolution
+    convPlan.Execute(buffers.estimateConvolved, buffers.next.GetInterior(), ConvolutionEpilogue::MULTIPLY, std::as_const(buffers.prev).GetInterior());
+    buffers.next.FillHalo();
+
+    std::swap(buffers.prev, buffers.next);
+}
+
+/// Returns true if the relative L2 change from 'prevEstimate' to 'estimate' during 'numIters' iterations
+/// is below 'tolerance' per iteration; always false if 'tolerance' is not positive.
+static bool HasConverged(
+    c_PaddedArrayPtr<const float> estimate,
+    c_PaddedArrayPtr<const float> prevEstimate, ///< Has as many rows and columns as 'estimate'
+    float numIters,
+    float tolerance
+)
+{
+    if (tolerance <= 0.0f)
+        return false;
+
+    const int width = estimate.width(), height = estimate.height();
+    double changeSq = 0.0, normSq = 0.0;
+    #pragma omp parallel for reduction(+:changeSq, normSq)
+    for (int y = 0; y < height; y++)
+    {
+        const float* estimateRow = estimate.row_const(y);
+        const float* prevEstimateRow = prevEstimate.row_const(y);
+        for (int x = 0; x < width; x++)
+        {
+            const double change = estimateRow[x] - prevEstimateRow[x];
+            changeSq += change * change;
+            normSq += static_cast<double>(prevEstimateRow[x]) * prevEstimateRow[x];
+        }
+    }
+
+    return changeSq < tolerance * tolerance * numIters * numIters * normSq;
+}
+
+/// Returns true if the last L-R step (which left the new estimate in 'buffers.prev' and the previous one in 'buffers.next')
+/// has changed the estimate by less than 'tolerance' (see 'HasConverged').
+static bool HasConverged(const LRBuffers& buffers, float tolerance)
+{
+    return HasConverged(buffers.prev.GetInterior(), buffers.next.GetInterior(), 1, tolerance);
+}
+
+/// Called after iterations of L-R deconvolution; arguments: number of iterations performed, current estimate.
+using LRIterationsDoneFn = std::function<void (int, c_PaddedArrayPtr<const float>)>;
+
+/// Performs L-R deconvolution processing the whole image in every iteration; returns the number of iterations performed.
+static int LucyRichardsonFullFrame(
+    c_PaddedArrayPtr<const float> input,
+    c_PaddedArrayPtr<const float> initialEstimate, ///< Estimate after 'startIter' iterations
+    c_PaddedArrayPtr<float> output,
+    int startIter,
+    int numIters,
+    float convergenceTolerance,
+    c_ConvolutionPlan& convPlan,
+    LRWorkspace& workspace,
+    const std::function<void (int, int)>& progressCallback,
+    const std::function<bool ()>& checkAbort,
+    const LRIterationsDoneFn& onIterationsDone
+)
+{
+    const int width = input.width(), height = input.height();
+
+    // Convolution inputs have a halo, so that the standard convolution does not need to handle image borders
+    LRBuffers& buffers = workspace.buffers;
+    buffers.Resize(width, height, convPlan.GetRequiredHalo());
+
+    for (int y = 0; y < height; y++)
+        memcpy(buffers.prev.GetInterior().row(y), initialEstimate.row_const(y), width * sizeof(float));
+    buffers.prev.FillHalo();
+
+    int itersDone = startIter;
+    while (itersDone < numIters)
+    {
+        Iterate(input, buffers, convPlan);
+        itersDone++;
+        onIterationsDone(itersDone, std::as_const(buffers.prev).GetInterior());
+
+        progressCallback(itersDone - 1, numIters);
+        if (checkAbort())
+            break;
+
+        if (HasConverged(buffers, convergenceTolerance))
+            break;
+    }
+
+    for (int y = 0; y < height; y++)
+        memcpy(output.row(y), buffers.prev.GetInterior().row(y), width * sizeof(float));
+
+    return itersDone;
+}
+
+/// Returns the number of fixed-step L-R iterations comparable to 'acceleratedIters' accelerated ones (inverse of GetAcceleratedLRIterations).
+static float GetEquivalentLRIterations(int acceleratedIters)
+{
+    return std::pow(acceleratedIters / LR_ACCELERATION_ITERS_COEFF, 1.0f / LR_ACCELERATION_ITERS_EXPONENT);
+}
+
+/// Performs L-R deconvolution accelerated with first-order vector extrapolation (Biggs & Andrews, 1997).
+/** Each L-R step is applied to a prediction 'y', extrapolated from the latest estimates 'x' along the previous
+    update direction: y[k+1] = x[k+1] + alpha * (x[k+1] - x[k]), where x[k+1] = LR_step(y[k]). The step length
+    'alpha' is estimated from the correlation of the last two updates g[k] = x[k+1] - y[k]. */
+static void LucyRichardsonAccelerated(
+    c_PaddedArrayPtr<const float> input,
+    c_PaddedArrayPtr<const float> initialEstimate,
+    c_PaddedArrayPtr<float> output,
+    int numIters,
+    float convergenceTolerance,
+    c_ConvolutionPlan& convPlan,
+    LRWorkspace& workspace,
+    const std::function<void (int, int)>& progressCallback,
+    const std::function<bool ()>& checkAbort
+)
+{
+    const int width = input.width(), height = input.height();
+
+    // 'buffers.prev' contains the prediction; after an L-R step, it contains the new estimate x[k+1]
+    // and 'buffers.next' - the prediction it was calculated from
+    LRBuffers& buffers = workspace.buffers;
+    buffers.Resize(width, height, convPlan.GetRequiredHalo());
+
+    std::vector<float>& prevEstimate = workspace.prevEstimate; // x[k]
+    prevEstimate.resize(static_cast<std::size_t>(width) * height);
+    std::vector<float>& prevUpdate = workspace.prevUpdate; // g[k-1]
+    prevUpdate.assign(prevEstimate.size(), 0.0f);
+
+    for (int y = 0; y < height; y++)
+    {
+        memcpy(buffers.prev.GetInterior().row(y), initialEstimate.row_const(y), width * sizeof(float));
+        memcpy(&prevEstimate[y * width], initialEstimate.row_const(y), width * sizeof(float));
+    }
+    buffers.prev.FillHalo();
+
+    for (int i = 0; i < numIters; i++)
+    {
+        Iterate(input, buffers, convPlan);
+
+        progressCallback(i, numIters);
+        if (i == numIters - 1 || checkAbort())
+            break;
+
+        c_PaddedArrayPtr<float> estimate = buffers.prev.GetInterior();
+        const c_PaddedArrayPtr<const float> prediction = std::as_const(buffers.next).GetInterior();
+
+        // An accelerated iteration changes the estimate as much as several fixed-step ones
+        const float equivalentIters = std::max(1.0f, GetEquivalentLRIterations(i + 1) - GetEquivalentLRIterations(i));
+        if (HasConverged(std::as_const(buffers.prev).GetInterior(), c_PaddedArrayPtr<const float>(prevEstimate.data(), width, height),
+                equivalentIters, convergenceTolerance))
+            break;
+
+        double updateCorrelation = 0.0; // g[k] . g[k-1]
+        double prevUpdateNormSq = 0.0; // g[k-1] . g[k-1]
+        #pragma omp parallel for reduction(+:updateCorrelation, prevUpdateNormSq)
+        for (int y = 0; y < height; y++)
+        {
+            const float* estimateRow = estimate.row(y);
+            const float* predictionRow = prediction.row_const(y);
+            const float* prevUpdateRow = &prevUpdate[y * width];
+            double rowCorrelation = 0.0, rowNormSq = 0.0;
+            for (int x = 0; x < width; x++)
+            {
+                const float update = estimateRow[x] - predictionRow[x];
+                rowCorrelation += update * prevUpdateRow[x];
+                rowNormSq += prevUpdateRow[x] * prevUpdateRow[x];
+            }
+            updateCorrelation += rowCorrelation;
+            prevUpdateNormSq += rowNormSq;
+        }
+
+        const float alpha = (prevUpdateNormSq > 0.0)
+            ? std::clamp(static_cast<float>(updateCorrelation / prevUpdateNormSq), 0.0f, LR_ACCELERATION_MAX_ALPHA)
+            : 0.0f;
+
+        // Replace the estimate with the next prediction (kept non-negative, as L-R requires), remembering
+        // the estimate and the update
+        #pragma omp parallel for
+        for (int y = 0; y < height; y++)
+        {
+            float* estimateRow = estimate.row(y);
+            const float* predictionRow = prediction.row_const(y);
+            float* prevEstimateRow = &prevEstimate[y * width];
+            float* prevUpdateRow = &prevUpdate[y * width];
+            for (int x = 0; x < width; x++)
+            {
+                const float newEstimate = estimateRow[x];
+                prevUpdateRow[x] = newEstimate - predictionRow[x];
+                estimateRow[x] = std::max(newEstimate + alpha * (newEstimate - prevEstimateRow[x]), 0.0f);
+                prevEstimateRow[x] = newEstimate;
+            }
+        }
+        buffers.prev.FillHalo();
+    }
+
+    for (int y = 0; y < height; y++)
+        memcpy(output.row(y), buffers.prev.GetInterior().row(y), width * sizeof(float));
+}
+
+int GetAcceleratedLRIterations(int equivalentIters)
+{
+    if (equivalentIters <= 0)
+        return 0;
+
+    const int iters = static_cast<int>(std::lround(LR_ACCELERATION_ITERS_COEFF * std::pow(equivalentIters, LR_ACCELERATION_ITERS_EXPONENT)));
+    return std::clamp(iters, 1, equivalentIters);
+}
+
+void c_LRResumableEstimate::Clear()
+{
+    m_Estimates.clear();
+    m_Latest = 0;
+    m_SnapshotInterval = LR_SNAPSHOT_INTERVAL;
+}
+
+int c_LRResumableEstimate::FindStart(int numIters) const
+{
+    auto it = m_Estimates.upper_bound(numIters);
+    return (it == m_Estimates.begin()) ? 0 : std::prev(it)->first;
+}
+
+c_PaddedArrayPtr<const float> c_LRResumableEstimate::GetEstimate(int numIters) const
+{
+    const auto& [width, height, values] = m_Estimates.at(numIters);
+    return c_PaddedArrayPtr<const float>(values.data(), width, height);
+}
+
+bool c_LRResumableEstimate::HasSnapshotInInterval(int numIters) const
+{
+    const int intervalStart = numIters / m_SnapshotInterval * m_SnapshotInterval;
+    for (auto it = m_Estimates.lower_bound(intervalStart); it != m_Estimates.end() && it->first < intervalStart + m_SnapshotInterval; ++it)
     {
-        float* row = buf.GetRowAs<float>(j);
-        for (unsigned i = 0; i < buf.GetWidth(); i++)
+        if (it->first != m_Latest)
+            return true;
+    }
+
+    return false;
+}
+
+bool c_LRResumableEstimate::IsSnapshotNeeded(int numIters) const
+{
+    return numIters >= m_SnapshotInterval && !HasSnapshotInInterval(numIters);
+}
+
+void c_LRResumableEstimate::ThinOutSnapshots()
+{
+    IMPPG_ASSERT(m_Latest == 0);
+
+    m_SnapshotInterval *= 2;
+
+    int keptIntervalStart = 0; // there are no snapshots in the first interval
+    for (auto it = m_Estimates.begin(); it != m_Estimates.end();)
+    {
+        const int intervalStart = it->first / m_SnapshotInterval * m_SnapshotInterval;
+        if (intervalStart == keptIntervalStart)
+            it = m_Estimates.erase(it);
+        else
         {
-            if (row[i] < 0.0f)
-                row[i] = 0.0f;
-            else if (row[i] > 1.0f)
-                row[i] = 1.0f;
+            keptIntervalStart = intervalStart;
+            ++it;
         }
     }
 }
 
+void c_LRResumableEstimate::Store(int numIters, c_PaddedArrayPtr<const float> estimate, bool isSnapshot)
+{
+    if (numIters == 0 || m_Estimates.count(numIters) > 0)
+        return;
+
+    if (m_Latest > 0)
+        m_Estimates.erase(m_Latest);
+    m_Latest = isSnapshot ? 0 : numIters;
+
+    if (isSnapshot)
+    {
+        const std::size_t frameBytes = static_cast<std::size_t>(estimate.width()) * estimate.height() * sizeof(float);
+        const std::size_t maxBytes = std::min(LR_MAX_SNAPSHOT_FRAMES * frameBytes, LR_MAX_SNAPSHOT_BYTES);
+        if (frameBytes > maxBytes)
+            return;
+
+        while ((m_Estimates.size() + 1) * frameBytes > maxBytes)
+            ThinOutSnapshots();
+
+        if (!IsSnapshotNeeded(numIters))
+            return;
+    }
+
+    Estimate& stored = m_Estimates[numIters];
+    stored.width = estimate.width();
+    stored.height = estimate.height();
+    stored.values.resize(static_cast<std::size_t>(stored.width) * stored.height);
+    for (int y = 0; y < stored.height; y++)
+        memcpy(&stored.values[y * stored.width], estimate.row_const(y), stored.width * sizeof(float));
+}
+
 /// Reproduces original image from image in 'input' convolved with Gaussian kernel and writes it to 'output'.
 void LucyRichardsonGaussian(
     c_View<const IImageBuffer>& input, ///< Contains a single 'float' value per pixel; size the same as 'output'
@@ -62,6 +359,12 @@ void LucyRichardsonGaussian(
     int numIters,  ///< Number of iterations
     float sigma,   ///< sigma of the Gaussian kernel
     ConvolutionMethod convMethod,
+    bool accelerated,
+    float convergenceTolerance,
+    c_ConvolutionPlan& convPlan, ///< Convolution plan; prepared for the image size, "sigma" and "convMethod"
+    LRWorkspace& workspace,
+    c_LRResumableEstimate* resumable,
+    c_View<const IImageBuffer>* warmStartEstimate,
 
     /// Called after every iteration; arguments: current iteration, total iterations
     std::function<void (int, int)> progressCallback,
@@ -70,84 +373,191 @@ void LucyRichardsonGaussian(
     std::function<bool ()> checkAbort
 )
 {
-    int width = input.GetWidth(), height = input.GetHeight();
-
-    auto prev = std::unique_ptr<float[]>(new float[width * height]);
-    auto next = std::unique_ptr<float[]>(new float[width * height]);
+    const int width = input.GetWidth(), height = input.GetHeight();
 
-    auto inputConvolvedDivT = std::unique_ptr<float[]>(new float[input.GetHeight() * input.GetWidth()]); // a transposed array
-    auto estimateConvolvedT = std::unique_ptr<float[]>(new float[input.GetHeight() * input.GetWidth()]); // a transposed array
-    auto conv2 = std::unique_ptr<float[]>(new float[input.GetWidth() * input.GetHeight()]);
+    const c_PaddedArrayPtr<const float> inputPtr = ToPaddedArray(c_TypedView<const float>(input));
+    const c_PaddedArrayPtr<float> outputPtr = ToPaddedArray(c_TypedView<float>(output));
 
-    auto inputT = std::unique_ptr<float[]>(new float[input.GetHeight() * input.GetWidth()]); // a transposed array
+    IMPPG_ASSERT(!warmStartEstimate || (!resumable &&
+        static_cast<int>(warmStartEstimate->GetWidth()) == width && static_cast<int>(warmStartEstimate->GetHeight()) == height));
+    const c_PaddedArrayPtr<const float> firstEstimate = warmStartEstimate
+        ? ToPaddedArray(c_TypedView<const float>(*warmStartEstimate))
+        : inputPtr;
 
-    Transpose(input.GetRowAs<const float>(0), inputT.get(), input.GetWidth(), input.GetHeight(),
-        input.GetBytesPerRow(), input.GetHeight() * sizeof(float), TRANSPOSITION_BLOCK_SIZE);
+    if (accelerated)
+    {
+        if (resumable)
+            resumable->Clear(); // the stored estimates do not contain the extrapolation state
+        convPlan.Prepare(width, height, sigma, convMethod);
+        LucyRichardsonAccelerated(inputPtr, firstEstimate, outputPtr, GetAcceleratedLRIterations(numIters), convergenceTolerance, convPlan, workspace, progressCallback, checkAbort);
+        return;
+    }
 
-    auto tempBuf1 = std::unique_ptr<float[]>(new float[input.GetWidth() * input.GetHeight()]);
-    auto tempBuf2 = std::unique_ptr<float[]>(new float[input.GetWidth() * input.GetHeight()]);
+    // Resume from the stored estimate closest to the requested number of iterations (if any)
+    if (convergenceTolerance > 0.0f)
+        resumable = nullptr; // the stored estimates may have converged earlier, with fewer iterations
+    const int startIter = resumable ? resumable->FindStart(numIters) : 0;
+    const c_PaddedArrayPtr<const float> initialEstimate = (startIter > 0) ? resumable->GetEstimate(startIter) : firstEstimate;
+    if (startIter > 0)
+        Log::Print(wxString::Format("Resuming L-R deconvolution after %d iterations\n", startIter));
+
+    const LRIterationsDoneFn onIterationsDone = [&](int itersDone, c_PaddedArrayPtr<const float> estimate) {
+        if (resumable && resumable->IsSnapshotNeeded(itersDone))
+            resumable->Store(itersDone, estimate, true);
+    };
+
+    convPlan.Prepare(width, height, sigma, convMethod);
+    const int itersDone = LucyRichardsonFullFrame(inputPtr, initialEstimate, outputPtr, startIter, numIters, convergenceTolerance,
+        convPlan, workspace, progressCallback, checkAbort, onIterationsDone);
+
+    if (resumable)
+        resumable->Store(itersDone, ToPaddedArray(c_TypedView<const float>(output)), false);
+}
 
-    int kernelRadius = static_cast<int>(ceil(sigma * 3.0f));
-    auto kernel = std::unique_ptr<float[]>(new float[2 * kernelRadius - 1]);
-    CalculateGaussianKernelProjection(kernel.get(), kernelRadius, sigma, true);
+std::optional<c_Image> PreparePSF(const c_Image& psf)
+{
+    IMPPG_ASSERT(psf.GetPixelFormat() == PixelFormat::PIX_MONO32F);
+    const int width = psf.GetWidth(), height = psf.GetHeight();
+    const c_TypedView<const float> psfValues(psf);
 
-    for (unsigned i = 0; i < input.GetHeight(); i++)
-        memcpy(prev.get() + i * input.GetWidth(), input.GetRow(i), input.GetWidth() * sizeof(float));
+    float background = psfValues.GetRow(0)[0];
+    for (int y = 0; y < height; y++)
+    {
+        const float* row = psfValues.GetRow(y);
+        background = std::min(background, *std::min_element(row, row + width));
+    }
 
-    for (int i = 0; i < numIters; i++)
+    double sum = 0.0, sumX = 0.0, sumY = 0.0;
+    for (int y = 0; y < height; y++)
     {
-        if (convMethod == ConvolutionMethod::STANDARD ||
-            convMethod == ConvolutionMethod::AUTO && kernelRadius < YOUNG_VAN_VLIET_MIN_KERNEL_RADIUS)
+        const float* row = psfValues.GetRow(y);
+        for (int x = 0; x < width; x++)
         {
-            ConvolveSeparableTranspose(
-                    c_PaddedArrayPtr<const float>(prev.get(), width, height),
-                    c_PaddedArrayPtr<float>(estimateConvolvedT.get(), height, width),
-                    kernel.get(), kernelRadius, tempBuf1.get(), tempBuf2.get());
+            const double value = row[x] - background;
+            sum += value;
+            sumX += value * x;
+            sumY += value * y;
         }
-        else
-            ConvolveGaussianRecursiveTranspose(
-                    c_PaddedArrayPtr<const float>(prev.get(), width, height),
-                    c_PaddedArrayPtr<float>(estimateConvolvedT.get(), height, width),
-                    sigma, tempBuf1.get(), tempBuf2.get());
-
-        #pragma omp parallel for
-        for (unsigned j = 0; j < input.GetHeight() * input.GetWidth(); j++)
-            inputConvolvedDivT[j] = inputT[j] / (estimateConvolvedT[j] + 1.0e-8f); // add a small epsilon to prevent division by 0 and propagation of NaNs across output pixels
-
-        // Note that 'height' and 'width' are switched in the below calls, as we use transposed arrays for input
-        if (convMethod == ConvolutionMethod::STANDARD ||
-            convMethod == ConvolutionMethod::AUTO && kernelRadius < YOUNG_VAN_VLIET_MIN_KERNEL_RADIUS)
+    }
+    if (!(sum > 0.0))
+        return std::nullopt;
+
+    // Center the PSF on its centroid; otherwise deconvolution would shift the image
+    const int centerX = std::clamp(static_cast<int>(std::lround(sumX / sum)), 0, width - 1);
+    const int centerY = std::clamp(static_cast<int>(std::lround(sumY / sum)), 0, height - 1);
+    const int radiusX = std::min({ centerX, width - 1 - centerX, LR_MAX_PSF_RADIUS });
+    const int radiusY = std::min({ centerY, height - 1 - centerY, LR_MAX_PSF_RADIUS });
+
+    c_Image result(2 * radiusX + 1, 2 * radiusY + 1, PixelFormat::PIX_MONO32F);
+    const c_TypedView<float> resultValues(result);
+    double croppedSum = 0.0;
+    for (int y = 0; y <= 2 * radiusY; y++)
+    {
+        const float* src = psfValues.GetRow(centerY - radiusY + y) + centerX - radiusX;
+        float* dest = resultValues.GetRow(y);
+        for (int x = 0; x <= 2 * radiusX; x++)
         {
-            ConvolveSeparableTranspose(
-                    c_PaddedArrayPtr<const float>(inputConvolvedDivT.get(), height, width),
-                    c_PaddedArrayPtr<float>(conv2.get(), width, height),
-                    kernel.get(), kernelRadius, tempBuf1.get(), tempBuf2.get());
+            dest[x] = src[x] - background;
+            croppedSum += dest[x];
         }
-        else
-            ConvolveGaussianRecursiveTranspose(
-                    c_PaddedArrayPtr<const float>(inputConvolvedDivT.get(), height, width),
-                    c_PaddedArrayPtr<float>(conv2.get(), width, width),
-                    sigma, tempBuf1.get(), tempBuf2.get());
+    }
+    if (!(croppedSum > 0.0))
+        return std::nullopt;
 
-        #pragma omp parallel for
-        for (unsigned j = 0; j < input.GetWidth() * input.GetHeight(); j++)
-            next[j] = prev[j] * conv2[j];
+    for (int y = 0; y <= 2 * radiusY; y++)
+    {
+        float* row = resultValues.GetRow(y);
+        for (int x = 0; x <= 2 * radiusX; x++)
+            row[x] = static_cast<float>(row[x] / croppedSum);
+    }
 
-        std::swap(prev, next);
+    return result;
+}
 
-        progressCallback(i, numIters);
+void LucyRichardsonPSF(
+    c_View<const IImageBuffer>& input,
+    c_View<IImageBuffer>& output,
+    int numIters,
+    float convergenceTolerance,
+    const c_Image& psf,
+    c_FFTConvolution& fftConv,
+    LRWorkspace& workspace,
+    c_View<const IImageBuffer>* warmStartEstimate,
+    std::function<void (int, int)> progressCallback,
+    std::function<bool ()> checkAbort
+)
+{
+    const int width = input.GetWidth(), height = input.GetHeight();
+
+    const c_PaddedArrayPtr<const float> inputPtr = ToPaddedArray(c_TypedView<const float>(input));
+    c_PaddedArrayPtr<float> outputPtr = ToPaddedArray(c_TypedView<float>(output));
+
+    IMPPG_ASSERT(!warmStartEstimate ||
+        (static_cast<int>(warmStartEstimate->GetWidth()) == width && static_cast<int>(warmStartEstimate->GetHeight()) == height));
+    const c_PaddedArrayPtr<const float> firstEstimate = warmStartEstimate
+        ? ToPaddedArray(c_TypedView<const float>(*warmStartEstimate))
+        : inputPtr;
+
+    fftConv.Prepare(width, height, ToPaddedArray(c_TypedView<const float>(psf)));
+
+    // The frequency-domain convolution handles the image borders itself, so no halo is needed
+    LRBuffers& buffers = workspace.buffers;
+    buffers.Resize(width, height, 0);
+
+    for (int y = 0; y < height; y++)
+        memcpy(buffers.prev.GetInterior().row(y), firstEstimate.row_const(y), width * sizeof(float));
+
+    for (int iter = 0; iter < numIters; iter++)
+    {
+        // The L-R correction is convolved with the flipped PSF; both steps have the element-wise operations fused
+        fftConv.Execute(std::as_const(buffers.prev).GetInterior(), buffers.estimateConvolved.GetInterior(), false, ConvolutionEpilogue::DIVIDE_INTO, inputPtr);
+        fftConv.Execute(std::as_const(buffers.estimateConvolved).GetInterior(), buffers.next.GetInterior(), true, ConvolutionEpilogue::MULTIPLY, std::as_const(buffers.prev).GetInterior());
+        std::swap(buffers.prev, buffers.next);
+
+        progressCallback(iter, numIters);
         if (checkAbort())
             break;
+
+        if (HasConverged(buffers, convergenceTolerance))
+            break;
+    }
+
+    for (int y = 0; y < height; y++)
+        memcpy(outputPtr.row(y), std::as_const(buffers.prev).GetInterior().row_const(y), width * sizeof(float));
+}
+
+/// Sets 'output[i]' to 1 if there is a nonzero element of 'input' at most 'radius' elements away from 'i', and to 0 otherwise.
+/** Runs in O(length), regardless of 'radius'. */
+static void DilateRow(const uint8_t input[], uint8_t output[], int length, int radius)
+{
+    if (std::all_of(input, input + length, [](uint8_t value) { return value == 0; }))
+    {
+        std::fill(output, output + length, 0);
+        return;
+    }
+
+    int dist = radius + 1; // distance from the nearest nonzero element on the left (saturated at 'radius' + 1)
+    for (int i = 0; i < length; i++)
+    {
+        dist = input[i] ? 0 : std::min(dist + 1, radius + 1);
+        output[i] = (dist <= radius);
     }
 
-    for (unsigned i = 0; i < input.GetHeight(); i++)
-        memcpy(output.GetRow(i), next.get() + i*input.GetWidth(), input.GetWidth() * sizeof(float));
+    dist = radius + 1; // distance from the nearest nonzero element on the right
+    for (int i = length - 1; i >= 0; i--)
+    {
+        dist = input[i] ? 0 : std::min(dist + 1, radius + 1);
+        output[i] |= (dist <= radius);
+    }
 }
 
-// Functions to encode/decode (x,y) pairs into a 64-bit integer.
-inline uint64_t encodeXY(uint32_t x, uint32_t y) { return x + (static_cast<uint64_t>(y) << 32); }
-inline std::tuple<uint32_t, uint32_t> decodeXY(uint64_t encoded) { return { encoded & 0xFFFF'FFFF, encoded >> 32 }; }
+/// Width of column strips processed in parallel by the vertical pass of FillTresholdVicinityMask.
+constexpr int VICINITY_MASK_STRIP_WIDTH = 256;
 
+/// Marks in 'mask' the pixels around borders of brightness areas defined by 'threshold'.
+/** Border pixels are those above 'threshold' which have a diagonal neighbor below it; the pixels within
+    ceil(2*sigma)-1 of them (in Chebyshev distance, i.e. in a square) are marked. The border pixels are dilated
+    separably, in parallel and in O(number of pixels), regardless of 'sigma'. */
 void FillTresholdVicinityMask(
     c_View<const IImageBuffer> input,
     std::vector<uint8_t>& mask,
@@ -158,57 +568,70 @@ void FillTresholdVicinityMask(
     IMPPG_ASSERT(input.GetPixelFormat() == PixelFormat::PIX_MONO32F);
     IMPPG_ASSERT(mask.size() == input.GetWidth() * input.GetHeight());
 
-    std::fill(mask.begin(), mask.end(), 0);
-
-    std::vector<uint64_t> borderPixels;
+    const int width = input.GetWidth();
+    const int height = input.GetHeight();
+    const int radius = static_cast<int>(ceilf(sigma * 2.0f)) - 1;
+    const c_TypedView<const float> inputValues(input);
 
-    // Identify all pixels above threshold and create a list of border pixels
-    // that are their neighbors, but themselves are below threshold.
-
-    for (int y = 0; y < static_cast<int>(input.GetHeight()); y++)
+    // Identify border pixels in each row and dilate them horizontally
+    #pragma omp parallel
     {
-        for (int x = 0; x < static_cast<int>(input.GetWidth()); x++)
+        std::vector<uint8_t> borderPixels(width);
+
+        #pragma omp for
+        for (int y = 0; y < height; y++)
         {
-            float valXY = input.GetRowAs<const float>(y)[x];
-            if (valXY < threshold)
+            // Mark the pixels having a diagonal neighbor below threshold, then keep those above it
+            std::fill(borderPixels.begin(), borderPixels.end(), 0);
+            for (const int neighborY: { y - 1, y + 1 })
             {
-                for (int j = -1; j <= 1; j++)
-                {
-                    for (int i = -1; i <= 1; i++)
-                    {
-                        if (i != 0 && j != 0 &&
-                            x + i >= 0 && x + i < static_cast<int>(input.GetWidth()) &&
-                            y + j >= 0 && y + j < static_cast<int>(input.GetHeight()))
-                        {
-                            if (input.GetRowAs<const float>(y + j)[x + i] >= threshold)
-                            {
-                                borderPixels.push_back(encodeXY(x + i, y + j));
-                            }
-                        }
-                    }
-                }
+                if (neighborY < 0 || neighborY >= height)
+                    continue;
+
+                const float* neighborRow = inputValues.GetRow(neighborY);
+                for (int x = 1; x < width; x++)
+                    borderPixels[x] |= (neighborRow[x - 1] < threshold);
+                for (int x = 0; x < width - 1; x++)
+                    borderPixels[x] |= (neighborRow[x + 1] < threshold);
             }
-        }
-    }
 
-    // Iterate over border pixels, identify all their neighbors to the specified distance
-    // and mark both sets in the mask.
+            const float* row = inputValues.GetRow(y);
+            for (int x = 0; x < width; x++)
+                borderPixels[x] &= (row[x] >= threshold);
 
-    const int influenceDist = static_cast<int>(ceilf(sigma * 2.0f));
+            DilateRow(borderPixels.data(), &mask[y * width], width, radius);
+        }
+    }
 
-    for (const auto bpix: borderPixels)
+    // Dilate vertically, in place. Each strip of columns is swept downwards and upwards, tracking the distance
+    // from the nearest horizontally dilated pixel (bit 0 of 'mask'); bit 1 marks the pixels reached by the downward sweep.
+    const int numStrips = (width + VICINITY_MASK_STRIP_WIDTH - 1) / VICINITY_MASK_STRIP_WIDTH;
+    #pragma omp parallel for
+    for (int strip = 0; strip < numStrips; strip++)
     {
-        const auto [x, y] = decodeXY(bpix);
+        const int x0 = strip * VICINITY_MASK_STRIP_WIDTH;
+        const int stripWidth = std::min(VICINITY_MASK_STRIP_WIDTH, width - x0);
+        std::vector<int> dist(stripWidth, radius + 1);
+
+        for (int y = 0; y < height; y++)
+        {
+            uint8_t* maskRow = &mask[y * width + x0];
+            for (int x = 0; x < stripWidth; x++)
+            {
+                dist[x] = (maskRow[x] & 1) ? 0 : std::min(dist[x] + 1, radius + 1);
+                if (dist[x] <= radius)
+                    maskRow[x] |= 2;
+            }
+        }
 
-        for (int i = -(influenceDist - 1); i <= influenceDist - 1; i++)
+        std::fill(dist.begin(), dist.end(), radius + 1);
+        for (int y = height - 1; y >= 0; y--)
         {
-            for (int j = -(influenceDist - 1); j <= influenceDist - 1; j++)
+            uint8_t* maskRow = &mask[y * width + x0];
+            for (int x = 0; x < stripWidth; x++)
             {
-                if (static_cast<int>(x) + i >= 0 && static_cast<int>(x) + i < static_cast<int>(input.GetWidth()) &&
-                    static_cast<int>(y) + j >= 0 && static_cast<int>(y) + j < static_cast<int>(input.GetHeight()))
-                {
-                    mask[(y + j) * input.GetWidth() + (x + i)] = 1;
-                }
+                dist[x] = (maskRow[x] & 1) ? 0 : std::min(dist[x] + 1, radius + 1);
+                maskRow[x] = (dist[x] <= radius || (maskRow[x] & 2));
             }
         }
     }
@@ -219,7 +642,8 @@ void BlurThresholdVicinity(
     c_View<IImageBuffer> output,
     std::vector<uint8_t>& workBuf,
     float threshold, ///< Threshold to qualify pixels as "border pixels".
-    float sigma
+    float sigma,
+    c_ConvolutionPlan& convPlan
 )
 {
     IMPPG_ASSERT(input.GetWidth() == output.GetWidth() &&
@@ -228,19 +652,25 @@ void BlurThresholdVicinity(
 
     FillTresholdVicinityMask(input, workBuf, threshold, sigma);
 
-    ConvolveSeparable(
-        c_PaddedArrayPtr(input.GetRowAs<const float>(0), input.GetWidth(), input.GetHeight(), input.GetBytesPerRow()),
-        c_PaddedArrayPtr(output.GetRowAs<float>(0), output.GetWidth(), output.GetHeight(), output.GetBytesPerRow()),
-        sigma
+    // The blurred values are needed only in the mask (usually a thin band), so the tiles without it are skipped;
+    // only the standard convolution (with a finite kernel) can skip them
+    const int width = input.GetWidth(), height = input.GetHeight();
+    const c_TypedView<const float> inputValues(input);
+    const c_TypedView<float> outputValues(output);
+    convPlan.Prepare(width, height, sigma, ConvolutionMethod::STANDARD);
+    convPlan.ExecuteMasked(
+        ToPaddedArray(inputValues),
+        ToPaddedArray(outputValues),
+        c_PaddedArrayPtr<const uint8_t>(workBuf.data(), width, height)
     );
 
-    for (unsigned y = 0; y < input.GetHeight(); ++y)
+    for (int y = 0; y < height; ++y)
     {
-        const float* srcRow = input.GetRowAs<const float>(y);
-        const uint8_t* maskRow = &workBuf[y * input.GetWidth()];
-        float* destRow = output.GetRowAs<float>(y);
+        const float* srcRow = inputValues.GetRow(y);
+        const uint8_t* maskRow = &workBuf[y * width];
+        float* destRow = outputValues.GetRow(y);
 
-        for (unsigned x = 0; x < input.GetWidth(); ++x)
+        for (int x = 0; x < width; ++x)
         {
             destRow[x] = (maskRow[x] == 0) ? srcRow[x] : destRow[x];
         }
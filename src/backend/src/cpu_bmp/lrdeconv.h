@@ -26,9 +26,14 @@ File description:
 
 #include "image/image.h"
 #include "math_utils/convolution.h"
+#include "math_utils/fft_convolution.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <map>
+#include <optional>
+#include <vector>
 
 /// Clamps the values of the specified PIX_MONO32F buffer to [0.0, 1.0]
 void Clamp(c_View<IImageBuffer>& buf);
@@ -40,13 +45,113 @@ void ConvolveSeparable(
         float sigma                           ///< Gaussian sigma
 );
 
+/// Maximum extrapolation step length (relative to the last update) of accelerated L-R deconvolution.
+constexpr float LR_ACCELERATION_MAX_ALPHA = 0.95f;
+
+/// Accelerated L-R deconvolution gives output comparable to N fixed-step iterations after
+/// COEFF * N^EXPONENT iterations (determined empirically for sigma 1-4 and N 10-200).
+constexpr float LR_ACCELERATION_ITERS_COEFF = 1.75f;
+constexpr float LR_ACCELERATION_ITERS_EXPONENT = 0.54f;
+
+/// Returns the number of accelerated L-R iterations giving output comparable to 'equivalentIters' fixed-step iterations.
+int GetAcceleratedLRIterations(int equivalentIters);
+
+/// Buffers used by Lucy-Richardson iterations.
+struct LRBuffers
+{
+    c_HaloImage prev; ///< Current estimate
+    c_HaloImage next;
+    c_HaloImage estimateConvolved; ///< Current estimate convolved, then 'input' divided by it
+
+    void Resize(int width, int height, int halo)
+    {
+        prev.Resize(width, height, halo);
+        next.Resize(width, height, halo);
+        estimateConvolved.Resize(width, height, halo);
+    }
+};
+
+/// Working memory of L-R deconvolution; kept by the caller between runs, so that it is reallocated only when the image grows.
+/** Holds at most 5 full-frame buffers: 3 in 'buffers' and 2 used only by accelerated L-R. */
+struct LRWorkspace
+{
+    LRBuffers buffers;
+
+    std::vector<float> prevEstimate; ///< Used by accelerated L-R.
+    std::vector<float> prevUpdate; ///< Used by accelerated L-R.
+};
+
+/// Initial interval (in iterations) of snapshots kept by c_LRResumableEstimate.
+constexpr int LR_SNAPSHOT_INTERVAL = 10;
+
+/// Maximum total size of snapshots kept by c_LRResumableEstimate, in frames (estimates).
+constexpr std::size_t LR_MAX_SNAPSHOT_FRAMES = 3;
+
+/// Maximum total size of snapshots kept by c_LRResumableEstimate, in bytes.
+constexpr std::size_t LR_MAX_SNAPSHOT_BYTES = 256 * 1024 * 1024;
+
+/// Estimates of (fixed-step) L-R deconvolution kept for resuming it with a different number of iterations.
+/** Contains the latest estimate and snapshots taken at intervals of LR_SNAPSHOT_INTERVAL iterations (starting
+    at LR_SNAPSHOT_INTERVAL). Once the snapshots would exceed LR_MAX_SNAPSHOT_FRAMES or LR_MAX_SNAPSHOT_BYTES,
+    the interval is doubled and the snapshots are thinned out accordingly.
+    The estimates are valid only for the same input and sigma; the owner has to call 'Clear' if they change. */
+class c_LRResumableEstimate
+{
+public:
+    void Clear();
+
+    /// Returns the highest number of iterations not exceeding 'numIters' for which there is an estimate (0 if none).
+    int FindStart(int numIters) const;
+
+    /// Returns the estimate after 'numIters' iterations (which must have been returned by 'FindStart').
+    c_PaddedArrayPtr<const float> GetEstimate(int numIters) const;
+
+    /// Returns true if the estimate after 'numIters' iterations should be stored as a snapshot.
+    bool IsSnapshotNeeded(int numIters) const;
+
+    /// Stores a copy of the estimate after 'numIters' iterations; replaces the previous latest estimate (unless it is a snapshot).
+    void Store(int numIters, c_PaddedArrayPtr<const float> estimate, bool isSnapshot);
+
+private:
+    struct Estimate
+    {
+        int width;
+        int height;
+        std::vector<float> values;
+    };
+
+    /// Returns true if there is a snapshot in the same snapshot interval as 'numIters'.
+    bool HasSnapshotInInterval(int numIters) const;
+
+    /// Doubles the snapshot interval and keeps only the first snapshot in each new interval; there must be no latest estimate.
+    void ThinOutSnapshots();
+
+    std::map<int, Estimate> m_Estimates; ///< Key: number of iterations.
+
+    int m_Latest{0}; ///< Number of iterations of the latest estimate, unless it is a snapshot; otherwise 0.
+
+    int m_SnapshotInterval{LR_SNAPSHOT_INTERVAL};
+};
+
 /// Reproduces original image from image in 'input' convolved with Gaussian kernel and writes it to 'output'.
 void LucyRichardsonGaussian(
         c_View<const IImageBuffer>& input, ///< Contains a single 'float' value per pixel; size the same as 'output'
         c_View<IImageBuffer>& output, ///< Contains a single 'float' value per pixel; size the same as 'input'
-        int numIters,  ///< Number of iterations
+        int numIters,  ///< Number of iterations; if 'accelerated' is true, number of equivalent fixed-step iterations
         float sigma,   ///< sigma of the Gaussian kernel
         ConvolutionMethod convMethod,
+        bool accelerated, ///< If true, Biggs-Andrews vector extrapolation is used to converge in fewer iterations
+        /// If > 0, iterations stop (before 'numIters') once the relative L2 change of the estimate per iteration
+        /// falls below this value (with 'accelerated': per equivalent fixed-step iteration).
+        float convergenceTolerance,
+        c_ConvolutionPlan& convPlan, ///< Convolution plan; prepared for the image size, "sigma" and "convMethod" if needed
+        LRWorkspace& workspace, ///< Resized as needed
+        /// If not null, the deconvolution starts from the stored estimate closest to 'numIters' (if any), and the results
+        /// are stored in it. Not used with 'convergenceTolerance'; cleared if 'accelerated' is true.
+        c_LRResumableEstimate* resumable,
+        /// If not null, the deconvolution starts from this estimate (e.g. the result for the previous frame of a sequence)
+        /// instead of from 'input'; size the same as 'input'. Must be null if 'resumable' is not.
+        c_View<const IImageBuffer>* warmStartEstimate,
 
         /// Called after every iteration; arguments: current iteration, total iterations
         //boost::function<void(int, int)> progressCallback,
@@ -57,6 +162,36 @@ void LucyRichardsonGaussian(
         std::function<bool ()> checkAbort
 );
 
+/// Maximum horizontal and vertical radius of a measured PSF used by LucyRichardsonPSF; larger PSF images are cropped.
+constexpr int LR_MAX_PSF_RADIUS = 127;
+
+/// Prepares a measured point spread function (e.g. an image of a star) for LucyRichardsonPSF.
+/** Subtracts the background (the minimum value), crops 'psf' (PIX_MONO32F) around its centroid to odd width
+    and height (at most 2*LR_MAX_PSF_RADIUS+1), so that the centroid is the middle pixel, and normalizes
+    the sum of values to 1. Returns an empty optional if 'psf' is flat. */
+std::optional<c_Image> PreparePSF(const c_Image& psf);
+
+/// Reproduces original image from image in 'input' convolved with the measured 'psf' and writes it to 'output'.
+/** Performs fixed-step L-R iterations, with the convolutions calculated in the frequency domain
+    (so that their cost does not depend on the PSF's size). */
+void LucyRichardsonPSF(
+        c_View<const IImageBuffer>& input, ///< Contains a single 'float' value per pixel; size the same as 'output'
+        c_View<IImageBuffer>& output, ///< Contains a single 'float' value per pixel; size the same as 'input'
+        int numIters,  ///< Number of iterations
+        /// If > 0, iterations stop (before 'numIters') once the relative L2 change of the estimate per iteration
+        /// falls below this value.
+        float convergenceTolerance,
+        const c_Image& psf, ///< Prepared by PreparePSF
+        c_FFTConvolution& fftConv, ///< Prepared for the image size and "psf" if needed
+        LRWorkspace& workspace, ///< Resized as needed
+        /// If not null, the deconvolution starts from this estimate instead of from 'input'; size the same as 'input'.
+        c_View<const IImageBuffer>* warmStartEstimate,
+        /// Called after every iteration; arguments: current iteration, total iterations
+        std::function<void (int, int)> progressCallback,
+        /// Called periodically to check if there was an "abort processing" request
+        std::function<bool ()> checkAbort
+);
+
 // c_Image GetTresholdVicinityMask(
 //     c_View<const IImageBuffer> input,
 //     float threshold, ///< Threshold to qualify pixels as "border pixels".
@@ -70,7 +205,8 @@ void BlurThresholdVicinity(
     c_View<IImageBuffer> output,
     std::vector<uint8_t>& workBuf,
     float threshold, ///< Threshold to qualify pixels as "border pixels".
-    float sigma
+    float sigma,
+    c_ConvolutionPlan& convPlan ///< Used for blurring; prepared as needed
 );
 
 #endif // IMPP_LRDECONV_H
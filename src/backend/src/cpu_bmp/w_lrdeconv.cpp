@@ -33,14 +33,31 @@ c_LucyRichardsonThread::c_LucyRichardsonThread(
     WorkerParameters&& params,
     float lrSigma,
     int numIterations,
+    bool accelerated,
+    float convergenceTolerance,
     bool deringing,
     float deringingThreshold,
     float deringingSigma,
-    std::vector<uint8_t>& deringingWorkBuf
+    std::vector<uint8_t>& deringingWorkBuf,
+    c_ConvolutionPlan& deringingConvPlan,
+    c_ConvolutionPlan& convPlan,
+    LRWorkspace& workspace,
+    const c_Image* measuredPsf,
+    c_FFTConvolution& psfConv,
+    c_LRResumableEstimate* resumable,
+    std::optional<c_View<const IImageBuffer>> warmStartEstimate
 ): IWorkerThread(std::move(params)),
    lrSigma(lrSigma),
    numIterations(numIterations),
-   m_Deringing{deringing, deringingThreshold, deringingSigma, deringingWorkBuf}
+   accelerated(accelerated),
+   convergenceTolerance(convergenceTolerance),
+   m_Deringing{deringing, deringingThreshold, deringingSigma, deringingWorkBuf, deringingConvPlan},
+   m_ConvPlan(convPlan),
+   m_Workspace(workspace),
+   m_MeasuredPsf(measuredPsf),
+   m_PsfConv(psfConv),
+   m_Resumable(resumable),
+   m_WarmStartEstimate(std::move(warmStartEstimate))
 {
 }
 
@@ -62,14 +79,26 @@ void c_LucyRichardsonThread::DoWork()
     {
         preprocessedInputImg = std::make_unique<c_Image>(m_Params.input.GetWidth(), m_Params.input.GetHeight(), PixelFormat::PIX_MONO32F);
         auto preprocView = c_View(preprocessedInputImg->GetBuffer());
-        BlurThresholdVicinity(m_Params.input, preprocView, m_Deringing.workBuf, m_Deringing.threshold, m_Deringing.sigma);
+        BlurThresholdVicinity(m_Params.input, preprocView, m_Deringing.workBuf, m_Deringing.threshold, m_Deringing.sigma, m_Deringing.convPlan);
         preprocessedInput = c_View<const IImageBuffer>(preprocessedInputImg->GetBuffer());
     }
 
-    LucyRichardsonGaussian(preprocessedInput, m_Params.output, numIterations, lrSigma, ConvolutionMethod::AUTO,
-        [this](int currentIter, int totalIters) { IterationNotification(currentIter, totalIters); },
-        [this]() { return IsAbortRequested(); }
-    );
+    if (m_MeasuredPsf)
+    {
+        LucyRichardsonPSF(preprocessedInput, m_Params.output, numIterations, convergenceTolerance, *m_MeasuredPsf, m_PsfConv, m_Workspace,
+            m_WarmStartEstimate.has_value() ? &m_WarmStartEstimate.value() : nullptr,
+            [this](int currentIter, int totalIters) { IterationNotification(currentIter, totalIters); },
+            [this]() { return IsAbortRequested(); }
+        );
+    }
+    else
+    {
+        LucyRichardsonGaussian(preprocessedInput, m_Params.output, numIterations, lrSigma, ConvolutionMethod::AUTO, accelerated, convergenceTolerance, m_ConvPlan, m_Workspace, m_Resumable,
+            m_WarmStartEstimate.has_value() ? &m_WarmStartEstimate.value() : nullptr,
+            [this](int currentIter, int totalIters) { IterationNotification(currentIter, totalIters); },
+            [this]() { return IsAbortRequested(); }
+        );
+    }
     Log::Print(wxString::Format("L-R deconvolution finished in %s s\n", (wxDateTime::UNow() - tstart).Format("%S.%l")));
     Clamp(m_Params.output);
 }
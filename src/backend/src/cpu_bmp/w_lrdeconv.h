@@ -24,7 +24,12 @@ File description:
 #ifndef IMPPG_LR_DECONV_WORKER_THREAD_H
 #define IMPPG_LR_DECONV_WORKER_THREAD_H
 
+#include <optional>
+
+#include "cpu_bmp/lrdeconv.h"
 #include "cpu_bmp/worker.h"
+#include "math_utils/convolution.h"
+#include "math_utils/fft_convolution.h"
 
 namespace imppg::backend {
 
@@ -34,14 +39,29 @@ class c_LucyRichardsonThread : public IWorkerThread
 
     float lrSigma;
     int numIterations;
+    bool accelerated;
+    float convergenceTolerance;
     struct
     {
         bool enabled;
         float threshold;
         float sigma;
         std::vector<uint8_t>& workBuf; ///< Must have as many elements as there are input pixels.
+        c_ConvolutionPlan& convPlan;
     } m_Deringing;
 
+    c_ConvolutionPlan& m_ConvPlan;
+
+    LRWorkspace& m_Workspace;
+
+    const c_Image* m_MeasuredPsf;
+
+    c_FFTConvolution& m_PsfConv;
+
+    c_LRResumableEstimate* m_Resumable;
+
+    std::optional<c_View<const IImageBuffer>> m_WarmStartEstimate;
+
     void IterationNotification(int iter, int totalIters);
 
 public:
@@ -49,10 +69,19 @@ public:
         WorkerParameters&& params,
         float lrSigma,             ///< Lucy-Richardson deconvolution Gaussian kernel's sigma.
         int numIterations,         ///< Number of L-R deconvolution iterations.
+        bool accelerated,          ///< If 'true', accelerated L-R deconvolution is used ('numIterations' is the equivalent number of fixed-step iterations).
+        float convergenceTolerance, ///< If > 0, iterations stop once the relative change of the estimate falls below it ('numIterations' is the maximum).
         bool deringing,            ///< If 'true', ringing around a specified threshold of brightness will be reduced.
         float deringingThreshold,
         float deringingSigma,
-        std::vector<uint8_t>& deringingWorkBuf ///< Must have as many elements as there are input pixels.
+        std::vector<uint8_t>& deringingWorkBuf, ///< Must have as many elements as there are input pixels.
+        c_ConvolutionPlan& deringingConvPlan, ///< Plan used for blurring the vicinity of the threshold; prepared as needed.
+        c_ConvolutionPlan& convPlan, ///< Plan used for the convolutions; prepared as needed.
+        LRWorkspace& workspace,    ///< Working memory of L-R deconvolution; resized as needed.
+        const c_Image* measuredPsf, ///< If not null, used instead of the Gaussian PSF ('accelerated' is then ignored); prepared by PreparePSF().
+        c_FFTConvolution& psfConv, ///< Used for the convolutions with 'measuredPsf'; prepared as needed.
+        c_LRResumableEstimate* resumable, ///< If not null, used to resume from (and store) the estimates of previous runs.
+        std::optional<c_View<const IImageBuffer>> warmStartEstimate ///< If set, deconvolution starts from it instead of from the input; 'resumable' must be null.
     );
 };
 
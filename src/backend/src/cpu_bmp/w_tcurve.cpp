@@ -21,6 +21,7 @@ File description:
     Tone curve worker thread implementation.
 */
 
+#include <algorithm>
 #include <wx/datetime.h>
 
 #include "cpu_bmp/w_tcurve.h"
@@ -31,35 +32,34 @@ namespace imppg::backend {
 
 c_ToneCurveThread::c_ToneCurveThread(
     WorkerParameters&& params,
-    const c_ToneCurve& toneCurve,   ///< Tone curve to apply to 'output'; an internal copy will be created
-    bool usePreciseValues           ///< If 'false', the approximated curve's values will be used
+    c_ToneCurve& toneCurve          ///< Tone curve to apply to 'output'; its LUT is calculated only if missing
 ): IWorkerThread(std::move(params)),
-   toneCurve(toneCurve),
-   m_UsePreciseValues(usePreciseValues)
+   toneCurve(toneCurve)
 {}
 
 void c_ToneCurveThread::DoWork()
 {
     wxDateTime tstart = wxDateTime::UNow();
-    toneCurve.RefreshLut();
+    if (!toneCurve.HasLut())
+        toneCurve.RefreshLut();
 
-    int lastPercentageReported = 0;
-    for (unsigned y = 0; y < m_Params.output.GetHeight(); y++)
+    const c_TypedView<const float> inputValues(m_Params.input);
+    const c_TypedView<float> outputValues(m_Params.output);
+    const int height = outputValues.GetHeight();
+
+    // Rows are processed in parallel, in bands of ~5% of the image; the main thread is notified after each band
+    const int bandHeight = std::max(1, height / 20);
+    for (int bandStart = 0; bandStart < height; bandStart += bandHeight)
     {
-        if (m_UsePreciseValues)
-            toneCurve.ApplyPreciseToneCurve(m_Params.input.GetRowAs<const float>(y), m_Params.output.GetRowAs<float>(y), m_Params.output.GetWidth());
-        else
-            toneCurve.ApplyApproximatedToneCurve(m_Params.input.GetRowAs<const float>(y), m_Params.output.GetRowAs<float>(y), m_Params.output.GetWidth());
-
-        // Notify the main thread after every 5% of progress
-        int percentage = 100 * y / m_Params.output.GetHeight();
-        if (percentage > lastPercentageReported + 5)
-        {
-            WorkerEventPayload payload;
-            payload.percentageComplete = percentage;
-            SendMessageToParent(ID_PROCESSING_PROGRESS, payload);
-            lastPercentageReported = percentage;
-        }
+        const int bandEnd = std::min(bandStart + bandHeight, height);
+
+        #pragma omp parallel for
+        for (int y = bandStart; y < bandEnd; y++)
+            toneCurve.ApplyApproximatedToneCurve(inputValues.GetRow(y), outputValues.GetRow(y), outputValues.GetWidth());
+
+        WorkerEventPayload payload;
+        payload.percentageComplete = 100 * bandEnd / height;
+        SendMessageToParent(ID_PROCESSING_PROGRESS, payload);
 
         if (IsAbortRequested())
             break;
@@ -33,14 +33,12 @@ class c_ToneCurveThread: public IWorkerThread
 {
     void DoWork() override;
 
-    c_ToneCurve toneCurve;
-    bool m_UsePreciseValues;
+    c_ToneCurve& toneCurve;
 
 public:
     c_ToneCurveThread(
         WorkerParameters&& params,
-        const c_ToneCurve &toneCurve,   ///< Tone curve to apply to 'output'; an internal copy will be created
-        bool usePreciseValues           ///< If 'false', the approximated curve's values will be used
+        c_ToneCurve &toneCurve          ///< Tone curve to apply to 'output'; its LUT is calculated only if missing
     );
 
 };
@@ -21,8 +21,11 @@ File description:
     Unsharp masking worker thread implementation.
 */
 
+#include <algorithm>
+
 #include "cpu_bmp/lrdeconv.h"
 #include "cpu_bmp/w_unshmask.h"
+#include "math_utils/pixel_ops.h"
 
 namespace imppg::backend {
 
@@ -34,7 +37,13 @@ c_UnsharpMaskingThread::c_UnsharpMaskingThread(
     float amountMin, ///< Unsharp masking amount min
     float amountMax, ///< Unsharp masking amount max (or just "amount" if 'adaptive' is false)
     float threshold, ///< Brightness threshold for transition from 'amount_min' to 'amount_max'
-    float width      ///< Transition width
+    float width,     ///< Transition width
+    c_ConvolutionPlan& convPlan,
+    std::vector<float>& blurBuf,
+    bool blurBufValid,
+    std::vector<float>& steeringBuf,
+    bool steeringBufValid,
+    const std::optional<c_ToneCurve>& toneCurve
 )
 : IWorkerThread(std::move(params)),
   m_RawInput(std::move(rawInput)),
@@ -43,7 +52,13 @@ c_UnsharpMaskingThread::c_UnsharpMaskingThread(
   m_AmountMin(amountMin),
   m_AmountMax(amountMax),
   m_Threshold(threshold),
-  m_Width(width)
+  m_Width(width),
+  m_ConvPlan(convPlan),
+  m_BlurBuf(blurBuf),
+  m_BlurBufValid(blurBufValid),
+  m_SteeringBuf(steeringBuf),
+  m_SteeringBufValid(steeringBufValid),
+  m_ToneCurve(toneCurve)
 {
     IMPPG_ASSERT(m_Params.input.GetWidth() == rawInput.GetWidth());
     IMPPG_ASSERT(m_Params.output.GetWidth() == rawInput.GetWidth());
@@ -57,63 +72,92 @@ void c_UnsharpMaskingThread::DoWork()
     // Width and height of all images (input, raw input, output) are the same
     int width = m_Params.input.GetWidth(), height = m_Params.input.GetHeight();
 
-    auto gaussianImg = std::make_unique<float[]>(width * height);
-
-    ConvolveSeparable(
-        c_PaddedArrayPtr(m_Params.input.GetRowAs<const float>(0), width, height, m_Params.input.GetBytesPerRow()),
-        c_PaddedArrayPtr(gaussianImg.get(), width, height), m_Sigma
-    );
+    const std::size_t numPixels = static_cast<std::size_t>(width) * height;
+    const c_TypedView<const float> inputValues(m_Params.input);
+    const c_TypedView<float> outputValues(m_Params.output);
 
-    if (!m_Adaptive)
+    if (!m_BlurBufValid)
     {
-        // Standard unsharp masking - the amount (taken from 'm_AmountMax') is constant for the whole image.
-
-        for (int row = 0; row < height; row++)
-            for (int col = 0; col < width; col++)
-                m_Params.output.GetRowAs<float>(row)[col] =
-                    m_AmountMax * m_Params.input.GetRowAs<const float>(row)[col] + (1.0f - m_AmountMax) * gaussianImg[row * width + col];
+        m_BlurBuf.resize(numPixels);
+        m_ConvPlan.Prepare(width, height, m_Sigma);
+        m_ConvPlan.Execute(
+            ToPaddedArray(inputValues),
+            c_PaddedArrayPtr(m_BlurBuf.data(), width, height)
+        );
     }
-    else
+    IMPPG_ASSERT(m_BlurBuf.size() == numPixels);
+    const float* gaussianImg = m_BlurBuf.data();
+
+    // Adaptive unsharp masking - the amount depends on input image's local brightness
+    // (henceforth "brightness").
+    //
+    // Local brightness is taken from the raw, unprocessed image (`m_RawInput`)
+    // smoothed by Gaussian with sigma = RAW_IMAGE_BLUR_SIGMA_FOR_ADAPTIVE_UNSHARP_MASK
+    // to alleviate noise.
+    //
+    // See the declaration of `GetAdaptiveUnshMaskTransitionCurve` for further details.
+
+    // gaussian-smoothed raw image to provide the local "steering" brightness
+    const float* imgL = nullptr;
+    CubicTransition amount{};
+    if (m_Adaptive)
     {
-        // Adaptive unsharp masking - the amount depends on input image's local brightness
-        // (henceforth "brightness").
-        //
-        // Local brightness is taken from the raw, unprocessed image (`m_RawInput`)
-        // smoothed by Gaussian with sigma = RAW_IMAGE_BLUR_SIGMA_FOR_ADAPTIVE_UNSHARP_MASK
-        // to alleviate noise.
-        //
-        // See the declaration of `GetAdaptiveUnshMaskTransitionCurve` for further details.
-
-        // gaussian-smoothed raw image to provide the local "steering" brightness
-        std::unique_ptr<float[]> imgL(new float[width * height]);
-        ConvolveSeparable(
-            c_PaddedArrayPtr(m_RawInput.GetRowAs<const float>(0), width, height, m_RawInput.GetBytesPerRow()),
-            c_PaddedArrayPtr(imgL.get(), width, height),
-            RAW_IMAGE_BLUR_SIGMA_FOR_ADAPTIVE_UNSHARP_MASK
-        );
+        if (!m_SteeringBufValid)
+        {
+            m_SteeringBuf.resize(numPixels);
+            ConvolveSeparable(
+                ToPaddedArray(c_TypedView<const float>(m_RawInput)),
+                c_PaddedArrayPtr(m_SteeringBuf.data(), width, height),
+                RAW_IMAGE_BLUR_SIGMA_FOR_ADAPTIVE_UNSHARP_MASK
+            );
+        }
+        IMPPG_ASSERT(m_SteeringBuf.size() == numPixels);
+        imgL = m_SteeringBuf.data();
+
+        const auto transitionCurve = GetAdaptiveUnshMaskTransitionCurve(m_AmountMin, m_AmountMax, m_Threshold, m_Width);
+        amount = CubicTransition{
+            m_Threshold - m_Width, m_Threshold + m_Width,
+            m_AmountMin, m_AmountMax,
+            transitionCurve[0], transitionCurve[1], transitionCurve[2], transitionCurve[3]
+        };
+    }
 
-        const auto& [a, b, c, d] = GetAdaptiveUnshMaskTransitionCurve(m_AmountMin, m_AmountMax, m_Threshold, m_Width);
+    if (m_ToneCurve.has_value())
+        m_ToneCurve->RefreshLut();
+
+    // Blending, clamping and the (optional) tone curve are applied to each row while it is in cache.
+    // Rows are processed in parallel, in bands of ~5% of the image; abort requests are checked after each band.
+    const int bandHeight = std::max(1, height / 20);
+    for (int bandStart = 0; bandStart < height; bandStart += bandHeight)
+    {
+        const int bandEnd = std::min(bandStart + bandHeight, height);
 
-        for (int row = 0; row < height; row++)
-            for (int col = 0; col < width; col++)
+        #pragma omp parallel for
+        for (int row = bandStart; row < bandEnd; row++)
+        {
+            const float* input = inputValues.GetRow(row);
+            const float* blurred = gaussianImg + row * width;
+            float* output = outputValues.GetRow(row);
+
+            if (!m_Adaptive)
             {
-                float amount = 1.0f;
-                float l = imgL[row * width + col];
-
-                if (l < m_Threshold - m_Width)
-                    amount = m_AmountMin;
-                else if (l > m_Threshold + m_Width)
-                    amount = m_AmountMax;
-                else
-                    amount = l * (l * (a * l + b) + c) + d;
-
-                m_Params.output.GetRowAs<float>(row)[col] =
-                    amount * m_Params.input.GetRowAs<const float>(row)[col] +
-                    (1.0f - amount) * gaussianImg[row*m_Params.input.GetWidth() + col];
+                // Standard unsharp masking - the amount (taken from 'm_AmountMax') is constant for the whole image.
+                BlendRow(input, blurred, output, width, m_AmountMax);
+            }
+            else
+            {
+                BlendRowAdaptive(input, blurred, imgL + row * width, output, width, amount);
             }
-    }
 
-    Clamp(m_Params.output);
+            ClampRow(output, output, width);
+
+            if (m_ToneCurve.has_value())
+                m_ToneCurve->ApplyApproximatedToneCurve(output, output, width);
+        }
+
+        if (IsAbortRequested())
+            break;
+    }
 }
 
 } // namespace imppg::backend
@@ -24,7 +24,11 @@ File description:
 #ifndef IMPPG_UNSHARP_MASKING_WORKER_THREAD_H
 #define IMPPG_UNSHARP_MASKING_WORKER_THREAD_H
 
+#include <optional>
+
+#include "common/tcrv.h"
 #include "cpu_bmp/worker.h"
+#include "math_utils/convolution.h"
 
 namespace imppg::backend {
 
@@ -39,6 +43,14 @@ class c_UnsharpMaskingThread: public IWorkerThread
     float m_AmountMin, m_AmountMax;
     float m_Threshold, m_Width;
 
+    c_ConvolutionPlan& m_ConvPlan;
+    std::vector<float>& m_BlurBuf; ///< Receives the Gaussian-blurred input; resized as needed.
+    bool m_BlurBufValid; ///< If true, `m_BlurBuf` already contains the blurred input.
+    std::vector<float>& m_SteeringBuf; ///< Receives the blurred raw input (in adaptive mode); resized as needed.
+    bool m_SteeringBufValid; ///< If true, `m_SteeringBuf` already contains the blurred raw input.
+
+    std::optional<c_ToneCurve> m_ToneCurve; ///< If set, applied to the output in the same pass.
+
 public:
     c_UnsharpMaskingThread(
         WorkerParameters&& params,
@@ -48,7 +60,15 @@ public:
         float amountMin, ///< Unsharp masking amount min
         float amountMax, ///< Unsharp masking amount max (or just "amount" if 'adaptive' is false)
         float threshold,  ///< Brightness threshold for transition from 'amountMin' to 'amountMax'
-        float width       ///< Transition width
+        float width,      ///< Transition width
+        c_ConvolutionPlan& convPlan, ///< Plan used for blurring the input; prepared as needed
+        std::vector<float>& blurBuf, ///< Buffer for the blurred input; resized as needed
+        bool blurBufValid, ///< If true, 'blurBuf' already contains the blurred input (kept from a previous run)
+        std::vector<float>& steeringBuf, ///< Buffer for the blurred raw input (used in adaptive mode); resized as needed
+        bool steeringBufValid, ///< If true, 'steeringBuf' already contains the blurred raw input (kept from a previous run)
+        /// If set, the tone curve is applied to the clamped output in the same pass over the image
+        /// (instead of by a separate c_ToneCurveThread); an internal copy will be created.
+        const std::optional<c_ToneCurve>& toneCurve = std::nullopt
     );
 };
 
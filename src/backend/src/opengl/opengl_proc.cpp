@@ -331,7 +331,8 @@ void c_OpenGLProcessing::StartLRDeconvolution()
                 c_View(m_BlurredForDeringing.image.value().GetBuffer()),
                 m_BlurredForDeringing.workBuf,
                 DERINGING_BRIGHTNESS_THRESHOLD,
-                m_ProcessingSettings.LucyRichardson.sigma
+                m_ProcessingSettings.LucyRichardson.sigma,
+                m_BlurredForDeringing.convPlan
             );
             m_BlurredForDeringing.texture = gl::c_Texture::CreateMono(
                 m_BlurredForDeringing.image.value().GetWidth(),
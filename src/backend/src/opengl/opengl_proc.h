@@ -27,6 +27,7 @@ File description:
 #include "backend/backend.h"
 #include "opengl/gl_utils.h"
 #include "image/image.h"
+#include "math_utils/convolution.h"
 
 #include <array>
 #include <vector>
@@ -155,6 +156,7 @@ private:
         std::optional<c_Image> image;
         gl::c_Texture texture;
         std::vector<uint8_t> workBuf;
+        c_ConvolutionPlan convPlan;
     } m_BlurredForDeringing;
 
     /// Framebuffer object and its associated texture; rendering to the FBO fills the texture.
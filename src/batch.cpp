@@ -95,7 +95,8 @@ public:
         wxArrayString fileNames,
         wxString settingsFileName,
         wxString outputDirectory,
-        OutputFormat outputFormat
+        OutputFormat outputFormat,
+        std::optional<LRWarmStartSettings> lrWarmStart
     );
 
     DECLARE_EVENT_TABLE()
@@ -215,6 +216,12 @@ void c_BatchDialog::OnProcessingCompleted(CompletionStatus status)
             m_ProcessNextFile = true;
         }
     }
+    else if (status == CompletionStatus::FAILED)
+    {
+        // the reason has been shown via the progress text; the subsequent files would fail as well
+        m_CurrentFileIdx = std::nullopt;
+        wxMessageBox(_("Processing failed; see the file's progress information for details."), _("Error"), wxICON_ERROR, this);
+    }
     else
     {
         SetProgressInfo("");
@@ -273,7 +280,8 @@ void c_BatchDialog::OnCommandEvent(wxCommandEvent& event)
 c_BatchDialog::c_BatchDialog(wxWindow* parent, wxArrayString fileNames,
     wxString settingsFileName,
     wxString outputDirectory,
-    OutputFormat outputFormat
+    OutputFormat outputFormat,
+    std::optional<LRWarmStartSettings> lrWarmStart
 )
 : wxDialog(parent, wxID_ANY, _("Batch processing"), wxDefaultPosition, wxDefaultSize,
         wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER)
@@ -289,6 +297,7 @@ c_BatchDialog::c_BatchDialog(wxWindow* parent, wxArrayString fileNames,
 
     m_Processor->SetProgressTextHandler([this](wxString info) { SetProgressInfo(info); });
     m_Processor->SetProcessingCompletedHandler([this](CompletionStatus status) { OnProcessingCompleted(status); });
+    m_Processor->SetLRWarmStart(lrWarmStart);
 
     m_FileOperationFailure = false;
 
@@ -351,7 +360,8 @@ void BatchProcessing(
             std::move(batchParamsDlg.GetInputFileNames()),
             batchParamsDlg.GetSettingsFileName(),
             batchParamsDlg.GetOutputDirectory(),
-            batchParamsDlg.GetOutputFormat());
+            batchParamsDlg.GetOutputFormat(),
+            batchParamsDlg.GetLRWarmStart());
         wxRect r = Configuration::BatchProgressDialogPosSize;
         batchDlg.SetPosition(r.GetPosition());
         batchDlg.SetSize(r.GetSize());
@@ -31,6 +31,7 @@ File description:
 #include <wx/filepicker.h>
 #include <wx/choice.h>
 #include <wx/statline.h>
+#include <wx/spinctrl.h>
 
 #include "appconfig.h"
 #include "batch_params.h"
@@ -46,7 +47,8 @@ enum
     ID_SettingsFilePicker,
     ID_SettingsFile,
     ID_OutputDir,
-    ID_OutputFormat
+    ID_OutputFormat,
+    ID_LRWarmStart
 };
 
 const int BORDER = 5; ///< Border size (in pixels) between controls
@@ -56,6 +58,7 @@ BEGIN_EVENT_TABLE(c_BatchParamsDialog, wxDialog)
     EVT_BUTTON(ID_Start, c_BatchParamsDialog::OnCommandEvent)
     EVT_BUTTON(wxID_CANCEL, c_BatchParamsDialog::OnCommandEvent)
     EVT_BUTTON(ID_RemoveSelected, c_BatchParamsDialog::OnCommandEvent)
+    EVT_CHECKBOX(ID_LRWarmStart, c_BatchParamsDialog::OnCommandEvent)
     EVT_DIRPICKER_CHANGED(ID_OutputDir, c_BatchParamsDialog::OnOutputDirChanged)
     EVT_FILEPICKER_CHANGED(ID_SettingsFilePicker, c_BatchParamsDialog::OnSettingsFileChanged)
 END_EVENT_TABLE()
@@ -80,6 +83,25 @@ wxString c_BatchParamsDialog::GetSettingsFileName()
     return m_SettingsFileCtrl->GetPath();
 }
 
+std::optional<imppg::backend::LRWarmStartSettings> c_BatchParamsDialog::GetLRWarmStart()
+{
+    if (!m_LRWarmStartCtrl->IsChecked())
+    {
+        return std::nullopt;
+    }
+
+    imppg::backend::LRWarmStartSettings settings;
+    settings.iterations = m_LRWarmStartItersCtrl->GetValue();
+    settings.keyframeInterval = m_LRWarmStartKeyframeCtrl->GetValue();
+    return settings;
+}
+
+void c_BatchParamsDialog::UpdateLRWarmStartControls()
+{
+    m_LRWarmStartItersCtrl->Enable(m_LRWarmStartCtrl->IsChecked());
+    m_LRWarmStartKeyframeCtrl->Enable(m_LRWarmStartCtrl->IsChecked());
+}
+
 
 void c_BatchParamsDialog::OnSettingsFileChanged(wxFileDirPickerEvent& event)
 {
@@ -116,6 +138,9 @@ void c_BatchParamsDialog::StoreConfiguration()
     Configuration::BatchDialogPosSize = wxRect(GetPosition(), GetSize());
     Configuration::BatchOutputPath = m_OutputDirCtrl->GetPath();
     Configuration::BatchOutputFormat = static_cast<OutputFormat>(m_OutputFormatsCtrl->GetSelection());
+    Configuration::BatchLRWarmStart = m_LRWarmStartCtrl->IsChecked();
+    Configuration::BatchLRWarmStartIterations = m_LRWarmStartItersCtrl->GetValue();
+    Configuration::BatchLRWarmStartKeyframeInterval = m_LRWarmStartKeyframeCtrl->GetValue();
 }
 
 void c_BatchParamsDialog::OnCommandEvent(wxCommandEvent& event)
@@ -164,6 +189,10 @@ void c_BatchParamsDialog::OnCommandEvent(wxCommandEvent& event)
             if (m_FileList->IsSelected(i))
                 m_FileList->Delete(i);
         break;
+
+    case ID_LRWarmStart:
+        UpdateLRWarmStartControls();
+        break;
     }
 }
 
@@ -226,6 +255,26 @@ void c_BatchParamsDialog::DoInitControls()
     szOutFmt->Add(m_OutputFormatsCtrl, 0, wxALIGN_CENTER_VERTICAL | wxALL, BORDER);
     szTop->Add(szOutFmt, 0, wxALIGN_LEFT | wxALL, BORDER);
 
+    szTop->Add(m_LRWarmStartCtrl = new wxCheckBox(GetContainer(), ID_LRWarmStart,
+        _(L"Start L\u2013R deconvolution of each image from the previous image's result")),
+        0, wxALIGN_LEFT | wxALL, BORDER);
+    m_LRWarmStartCtrl->SetValue(Configuration::BatchLRWarmStart);
+    m_LRWarmStartCtrl->SetToolTip(_("Speeds up processing of a sequence of similar images (e.g. frames of an aligned time-lapse). "
+        "Used only by the CPU + bitmaps back end."));
+
+    wxSizer* szWarmStart = new wxBoxSizer(wxHORIZONTAL);
+    szWarmStart->Add(new wxStaticText(GetContainer(), wxID_ANY, _("Iterations per image:")), 0, wxALIGN_CENTER_VERTICAL | wxALL, BORDER);
+    szWarmStart->Add(m_LRWarmStartItersCtrl = new wxSpinCtrl(GetContainer(), wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize,
+        wxSP_ARROW_KEYS, 1, 500, Configuration::BatchLRWarmStartIterations),
+        0, wxALIGN_CENTER_VERTICAL | wxALL, BORDER);
+    szWarmStart->Add(new wxStaticText(GetContainer(), wxID_ANY, _("Full deconvolution every")), 0, wxALIGN_CENTER_VERTICAL | wxALL, BORDER);
+    szWarmStart->Add(m_LRWarmStartKeyframeCtrl = new wxSpinCtrl(GetContainer(), wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize,
+        wxSP_ARROW_KEYS, 1, 1000, Configuration::BatchLRWarmStartKeyframeInterval),
+        0, wxALIGN_CENTER_VERTICAL | wxALL, BORDER);
+    szWarmStart->Add(new wxStaticText(GetContainer(), wxID_ANY, _("images")), 0, wxALIGN_CENTER_VERTICAL | wxALL, BORDER);
+    szTop->Add(szWarmStart, 0, wxALIGN_LEFT | wxALL, BORDER);
+    UpdateLRWarmStartControls();
+
     AssignContainerSizer(szTop);
 
     GetTopSizer()->Add(new wxStaticLine(this), 0, wxGROW | wxALL, BORDER);
@@ -21,14 +21,18 @@ File description:
     Batch processing parameters dialog header.
 */
 
+#include <optional>
 #include <wx/arrstr.h>
+#include <wx/checkbox.h>
 #include <wx/choice.h>
 #include <wx/dialog.h>
 #include <wx/event.h>
 #include <wx/filepicker.h>
 #include <wx/grid.h>
 #include <wx/listbox.h>
+#include <wx/spinctrl.h>
 
+#include "backend/backend.h"
 #include "image/image.h"
 #include "scrollable_dlg.h"
 
@@ -46,6 +50,11 @@ class c_BatchParamsDialog : public c_ScrollableDialog
     wxDirPickerCtrl* m_OutputDirCtrl{nullptr};
     wxChoice* m_OutputFormatsCtrl{nullptr};
     wxFilePickerCtrl* m_SettingsFileCtrl{nullptr};
+    wxCheckBox* m_LRWarmStartCtrl{nullptr};
+    wxSpinCtrl* m_LRWarmStartItersCtrl{nullptr};
+    wxSpinCtrl* m_LRWarmStartKeyframeCtrl{nullptr};
+
+    void UpdateLRWarmStartControls();
 
 public:
     c_BatchParamsDialog(wxWindow* parent);
@@ -54,6 +63,8 @@ public:
     wxString GetOutputDirectory();
     OutputFormat GetOutputFormat();
     wxString GetSettingsFileName();
+    /// Returns settings of warm-started L-R deconvolution if it has been chosen.
+    std::optional<imppg::backend::LRWarmStartSettings> GetLRWarmStart();
 
     DECLARE_EVENT_TABLE()
 };
@@ -26,6 +26,8 @@ File description:
 
 #include "common/tcrv.h"
 
+#include <string>
+
 struct ProcessingSettings
 {
     /// Normalization is performed prior to all other processing steps.
@@ -39,10 +41,26 @@ struct ProcessingSettings
     {
         float sigma; ///< Lucy-Richardson deconvolution kernel sigma
         int iterations{0}; ///< Number of Lucy-Richardson deconvolution iterations.
+        /// If true, accelerated L-R deconvolution is used (with fewer iterations, giving output comparable
+        /// to 'iterations' fixed-step ones). Not supported by all back ends; the others perform 'iterations' fixed-step iterations.
+        bool accelerated{false};
+        /// Convergence-based stopping; not supported by all back ends (the others perform 'iterations' iterations).
+        struct
+        {
+            bool enabled{false}; ///< If true, iterations stop once the estimate converges; 'iterations' is the maximum.
+            float tolerance{2.5e-4f}; ///< Relative L2 change of the estimate per iteration below which the iterations stop.
+        } convergenceStop;
         struct
         {
             bool enabled{false}; ///< Experimantal; enables deringing along edges of overexposed areas (see c_LucyRichardsonThread::DoWork()).
         } deringing;
+        /// Measured point spread function used instead of the Gaussian one ('sigma' is then used only for deringing).
+        /// Not supported by all back ends (the others use the Gaussian PSF); 'accelerated' is ignored when it is used.
+        struct
+        {
+            bool enabled{false};
+            std::string fileName; ///< Image of the PSF (e.g. of a star), see PreparePSF().
+        } measuredPsf;
     } LucyRichardson;
 
     struct
@@ -41,8 +41,23 @@ public:
     };
 
 private:
-    /// Look-up table with pre-calculated values of the curve.
-    std::optional<std::vector<float>> m_LUT;
+    /// Look-up table for a quick application of the curve.
+    /** Values between the entries are linearly interpolated; the result differs from the precise value by less
+        than one 16-bit step (1/65535), see RefreshLut(). */
+    struct Lut
+    {
+        /// Curve values at the beginnings of segments (i.e. at 0, 1/LUT_NUM_SEGMENTS, ...), see `InterpolateLutRow`.
+        /** Equal to IMPRECISE_LUT_SEGMENT for the segments where interpolation is not precise enough
+            (the curve is evaluated directly there instead). */
+        std::vector<float> values;
+
+        /// Differences between the curve values at the ends and at the beginnings of segments.
+        std::vector<float> slopes;
+
+        bool hasImpreciseSegments{false};
+    };
+
+    std::optional<Lut> m_LUT;
 
     /// Collection of curve points(X = curve argument, Y = curve value), sorted by X
     std::vector<FloatPoint_t> m_Points;
@@ -73,6 +88,12 @@ public:
     /// Calculates the look-up table for a quick approximated application of the curve
     void RefreshLut();
 
+    /// Returns 'true' if the LUT has been calculated (and not invalidated by an assignment) since construction.
+    bool HasLut() const { return m_LUT.has_value(); }
+
+    /// Returns 'true' if both curves map the inputs to the same values (i.e. their LUTs are interchangeable).
+    bool HasSameShape(const c_ToneCurve& other) const;
+
     /// Calculates spline coefficients
     void CalculateSpline();
 
@@ -88,21 +109,9 @@ public:
     bool GetSmooth() const { return m_Smooth; }
     void SetSmooth(bool smooth);
 
-    /// Tone-maps `input` to `output` using approximated tone curve values.
+    /// Tone-maps `input` to `output` (which may be the same as `input`) using the LUT.
     /** LUT is not calculated automatically. Caller must call RefreshLut() after any update to the curve before using this method. */
-    void ApplyApproximatedToneCurve(const float input[], float output[], size_t length)
-    {
-        IMPPG_ASSERT(m_LUT.has_value());
-        for (size_t i = 0; i < length; i++)
-            output[i] = (*m_LUT)[static_cast<int>(input[i] * (m_LUT->size() - 1))];
-    }
-
-    /// Tone-maps `input` to `output` using precise tone curve values.
-    void ApplyPreciseToneCurve(const float input[], float output[], size_t length)
-    {
-        for (size_t i = 0; i < length; i++)
-            output[i] = GetPreciseValue(input[i]);
-    }
+    void ApplyApproximatedToneCurve(const float input[], float output[], size_t length) const;
 
     /// Applies the tone curve to 'input' using a precise curve value
     float GetPreciseValue(
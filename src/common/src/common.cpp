@@ -66,9 +66,10 @@ Histogram DetermineHistogram(const c_Image& img, const wxRect& selection)
     histogram.minValue = FLT_MAX;
     histogram.maxValue = -FLT_MAX;
 
+    const c_TypedView<const float> pixels(img);
     for (int y = 0; y < selection.height; y++)
     {
-        const float* row = img.GetRowAs<float>(selection.y + y) + selection.x;
+        const float* row = pixels.GetRow(selection.y + y) + selection.x;
         for (int x = 0; x < selection.width; x++)
         {
             if (row[x] < histogram.minValue)
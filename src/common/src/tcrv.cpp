@@ -23,12 +23,26 @@ File description:
 
 #include <math.h>
 #include <algorithm>
+#include <cmath>
 
 #include "common/tcrv.h"
 #include "common/common.h"
 #include "math_utils/math_utils.h"
+#include "math_utils/pixel_ops.h"
 
-const int DEFAULT_LUT_SIZE = 1 << 16;
+/// Number of LUT segments; the LUT (values and slopes, 32 KiB) stays in L1 or L2 cache.
+const int LUT_NUM_SEGMENTS = 1 << 12;
+
+/// Maximum interpolation error (measured inside each LUT segment) for the segment to be used.
+/** Half of a 16-bit step; the margin accounts for the error being measured only at a few points. */
+const float LUT_MAX_ERROR = 0.5f / 65535;
+
+/// Value (outside the curve's range) stored in the LUT for imprecise segments; their slope is 0, so the inputs
+/// which fall into them are mapped to exactly this value.
+const float IMPRECISE_LUT_SEGMENT = -1.0f;
+
+/// Number of inputs processed at once by ApplyApproximatedToneCurve when some LUT segments are imprecise.
+const size_t LUT_FIXUP_CHUNK = 256;
 
 c_ToneCurve::c_ToneCurve()
 : m_Smooth(true), m_IsGamma(false), m_Gamma(1.0f)
@@ -59,6 +73,24 @@ c_ToneCurve& c_ToneCurve::operator=(const c_ToneCurve& c)
     return *this;
 }
 
+bool c_ToneCurve::HasSameShape(const c_ToneCurve& other) const
+{
+    if (m_IsGamma != other.m_IsGamma || m_Smooth != other.m_Smooth ||
+        (m_IsGamma && m_Gamma != other.m_Gamma) ||
+        m_Points.size() != other.m_Points.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_Points.size(); i++)
+    {
+        if (m_Points[i].x != other.m_Points[i].x || m_Points[i].y != other.m_Points[i].y)
+            return false;
+    }
+
+    return true;
+}
+
 void c_ToneCurve::UpdatePoint(int idx, float x, float y)
 {
     m_Points[idx].x = x;
@@ -200,12 +232,108 @@ int c_ToneCurve::GetIdxOfClosestPoint(
     return minIdx;
 }
 
-/// Calculates the 16-bit Look-Up Table for a quick approximated application of the curve
+#ifndef NDEBUG
+/// Checks that the LUT-based curve values differ from the precise ones by less than one 16-bit step
+/// (see c_ToneCurve::Lut) on a dense sweep of inputs (16 per LUT segment) and at the control points.
+static void VerifyLut(const c_ToneCurve& curve)
+{
+    constexpr int SAMPLES_PER_SEGMENT = 16;
+
+    std::vector<float> inputs;
+    inputs.reserve(LUT_NUM_SEGMENTS * SAMPLES_PER_SEGMENT + 1 + curve.GetNumPoints());
+    for (int i = 0; i <= LUT_NUM_SEGMENTS * SAMPLES_PER_SEGMENT; i++)
+        inputs.push_back(static_cast<float>(i) / (LUT_NUM_SEGMENTS * SAMPLES_PER_SEGMENT));
+    for (int i = 0; i < curve.GetNumPoints(); i++)
+        inputs.push_back(std::clamp(curve.GetPoint(i).x, 0.0f, 1.0f));
+
+    std::vector<float> outputs(inputs.size());
+    curve.ApplyApproximatedToneCurve(inputs.data(), outputs.data(), inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++)
+        IMPPG_ASSERT(std::abs(outputs[i] - curve.GetPreciseValue(inputs[i])) <= 1.0f / 65535);
+}
+#endif
+
+/// Calculates the Look-Up Table for a quick application of the curve.
+/** Linear interpolation of the LUT entries is checked against the precise values at 1/4, 1/2 and 3/4 of each segment
+    and at the control points (where the curve may have a corner); the segments with error above LUT_MAX_ERROR
+    (usually very few, e.g. at the steep beginning of a gamma curve) are marked to be evaluated directly. */
 void c_ToneCurve::RefreshLut()
 {
-    m_LUT = std::vector<float>{};
-    for (size_t i = 0; i < DEFAULT_LUT_SIZE; i++)
-        m_LUT->push_back(GetPreciseValue(i * 1.0f/(DEFAULT_LUT_SIZE - 1)));
+    Lut lut;
+    lut.values.resize(LUT_NUM_SEGMENTS);
+    lut.slopes.resize(LUT_NUM_SEGMENTS);
+    float segmentEnd = GetPreciseValue(0.0f);
+    for (int i = 0; i < LUT_NUM_SEGMENTS; i++)
+    {
+        lut.values[i] = segmentEnd;
+        segmentEnd = GetPreciseValue(static_cast<float>(i + 1) / LUT_NUM_SEGMENTS);
+        lut.slopes[i] = segmentEnd - lut.values[i];
+    }
+
+    const auto isImprecise = [&](float input) {
+        float interpolated;
+        InterpolateLutRow(lut.values.data(), lut.slopes.data(), LUT_NUM_SEGMENTS, &input, &interpolated, 1);
+        return std::abs(interpolated - GetPreciseValue(input)) > LUT_MAX_ERROR;
+    };
+    const auto getSegment = [](float input) { return std::min(static_cast<int>(input * LUT_NUM_SEGMENTS), LUT_NUM_SEGMENTS - 1); };
+
+    std::vector<int> impreciseSegments;
+    for (int i = 0; i < LUT_NUM_SEGMENTS; i++)
+    {
+        for (const float t: { 0.25f, 0.5f, 0.75f })
+        {
+            if (isImprecise((i + t) / LUT_NUM_SEGMENTS))
+            {
+                impreciseSegments.push_back(i);
+                break;
+            }
+        }
+    }
+    for (const FloatPoint_t& point: m_Points)
+    {
+        if (point.x > 0.0f && point.x < 1.0f && isImprecise(point.x))
+            impreciseSegments.push_back(getSegment(point.x));
+    }
+
+    for (int i: impreciseSegments)
+    {
+        lut.values[i] = IMPRECISE_LUT_SEGMENT;
+        lut.slopes[i] = 0.0f;
+    }
+    lut.hasImpreciseSegments = !impreciseSegments.empty();
+
+    m_LUT = std::move(lut);
+
+#ifndef NDEBUG
+    VerifyLut(*this);
+#endif
+}
+
+void c_ToneCurve::ApplyApproximatedToneCurve(const float input[], float output[], size_t length) const
+{
+    IMPPG_ASSERT(m_LUT.has_value());
+    const float* lutValues = m_LUT->values.data();
+    const float* lutSlopes = m_LUT->slopes.data();
+
+    if (!m_LUT->hasImpreciseSegments)
+    {
+        InterpolateLutRow(lutValues, lutSlopes, LUT_NUM_SEGMENTS, input, output, static_cast<int>(length));
+        return;
+    }
+
+    // The inputs are buffered, as `output` may be the same as `input`
+    float chunk[LUT_FIXUP_CHUNK];
+    for (size_t start = 0; start < length; start += LUT_FIXUP_CHUNK)
+    {
+        const size_t chunkLength = std::min(LUT_FIXUP_CHUNK, length - start);
+        std::copy(input + start, input + start + chunkLength, chunk);
+        InterpolateLutRow(lutValues, lutSlopes, LUT_NUM_SEGMENTS, chunk, output + start, static_cast<int>(chunkLength));
+        for (size_t i = 0; i < chunkLength; i++)
+        {
+            if (output[start + i] == IMPRECISE_LUT_SEGMENT)
+                output[start + i] = GetPreciseValue(chunk[i]);
+        }
+    }
 }
 
 /// Applies the tone curve to 'input' using a precise curve value
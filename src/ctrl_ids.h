@@ -47,6 +47,9 @@ enum
     ID_LucyRichardsonSigma,
     ID_LucyRichardsonReset,
     ID_LucyRichardsonDeringing,
+    ID_LucyRichardsonAccelerated,
+    ID_LucyRichardsonMeasuredPsf,
+    ID_LucyRichardsonPsfFile,
     ID_LucyRichardsonOff,
 
     ID_UnsharpMaskingSigma,
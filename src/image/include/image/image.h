@@ -25,6 +25,7 @@ File description:
 #define ImPPG_IMAGE_H
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -33,6 +34,7 @@ File description:
 #include <wx/gdicmn.h>
 
 #include "common/formats.h"
+#include "math_utils/convolution.h"
 #include "../../imppg_assert.h"
 
 
@@ -266,6 +268,59 @@ public:
     PixelFormat GetPixelFormat() const { return m_Buf->GetPixelFormat(); }
 };
 
+/// Non-virtual view of the rows of an image (or its fragment) as arrays of `T`; does not allocate any pixels memory itself.
+///
+/// The location of the rows is resolved once, at construction, so accessing them involves no virtual calls
+/// (and loops over them can be vectorized). Rows may be stored in reverse order (e.g. by `c_FreeImageBuffer`),
+/// in which case the distance between them is negative. The view becomes invalid when the underlying buffer
+/// is destroyed or reallocated.
+///
+/// T: pixel value type, `const`-qualified if the underlying image is `const`.
+///
+template<typename T>
+class c_TypedView
+{
+    using Byte = typename std::conditional<std::is_const<T>::value, const uint8_t, uint8_t>::type;
+
+    Byte* m_Origin; ///< Start of row 0
+    std::ptrdiff_t m_RowStride; ///< Distance in bytes from the start of a row to the start of the next one
+    int m_Width, m_Height;
+
+public:
+    c_TypedView(T* origin, std::ptrdiff_t rowStride, int width, int height)
+        : m_Origin(reinterpret_cast<Byte*>(origin)), m_RowStride(rowStride), m_Width(width), m_Height(height)
+    { }
+
+    /// Resolves the rows of `img`: an `IImageBuffer`, `c_Image` or `c_View` (`const`-qualified, if `T` is).
+    template<typename Img, typename = typename std::enable_if<!std::is_same<typename std::remove_const<Img>::type, c_TypedView>::value>::type>
+    explicit c_TypedView(Img& img)
+        : m_Origin(static_cast<Byte*>(img.GetRow(0))),
+          m_RowStride(img.GetHeight() > 1 ? static_cast<Byte*>(img.GetRow(1)) - m_Origin : 0),
+          m_Width(img.GetWidth()),
+          m_Height(img.GetHeight())
+    { }
+
+    /// Returns a read-only view of the same pixels.
+    template<typename U = T, typename = typename std::enable_if<!std::is_const<U>::value>::type>
+    operator c_TypedView<const U>() const { return c_TypedView<const U>(GetRow(0), m_RowStride, m_Width, m_Height); }
+
+    T* GetRow(int row) const { return reinterpret_cast<T*>(m_Origin + row * m_RowStride); }
+
+    int GetWidth() const { return m_Width; }
+
+    int GetHeight() const { return m_Height; }
+
+    /// Returns the distance in bytes between subsequent rows (negative if they are stored in reverse order).
+    std::ptrdiff_t GetRowStride() const { return m_RowStride; }
+};
+
+/// Returns the pixels of 'view' as an array to be processed by the math_utils routines.
+template<typename T>
+c_PaddedArrayPtr<T> ToPaddedArray(const c_TypedView<T>& view)
+{
+    return c_PaddedArrayPtr<T>(view.GetRow(0), view.GetWidth(), view.GetHeight(), static_cast<int>(view.GetRowStride()));
+}
+
 #if USE_FREEIMAGE
 
 struct FIBITMAP; // provided by FreeImage.h
@@ -22,7 +22,6 @@ File description:
 */
 
 #include <algorithm>
-#include <cfloat>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
@@ -33,6 +32,7 @@ File description:
 #include "../../imppg_assert.h"
 
 #include "image/image.h"
+#include "math_utils/pixel_ops.h"
 #if (USE_FREEIMAGE)
   #include "FreeImage.h"
   #ifdef __APPLE__
@@ -426,10 +426,10 @@ c_Image::c_Image(const c_Image& img)
 void c_Image::ClearToZero()
 {
     // works also for an array of floats; 32 zero bits represent a floating-point 0.0f
-    const unsigned w = GetWidth();
-    const unsigned h = GetHeight();
-    for (unsigned i = 0; i < h; i++)
-        memset(m_Buffer->GetRow(i), 0, w * m_Buffer->GetBytesPerPixel());
+    const c_TypedView<uint8_t> rows(*m_Buffer);
+    const size_t rowLength = GetWidth() * m_Buffer->GetBytesPerPixel();
+    for (int i = 0; i < rows.GetHeight(); i++)
+        memset(rows.GetRow(i), 0, rowLength);
 }
 
 template<typename Src, typename Dest, typename ConversionFunc>
@@ -475,12 +475,11 @@ static c_SimpleBuffer GetConvertedPixelFormatFragment(
         {
             c_SimpleBuffer result(width, height, destPixFmt);
 
+            const c_TypedView<const uint8_t> srcRows(srcBuf);
+            const c_TypedView<uint8_t> destRows(result);
             auto bpp = result.GetBytesPerPixel();
             for (unsigned j = 0; j < height; j++)
-                for (unsigned i = 0; i < height; i++)
-                    memcpy(result.GetRowAs<uint8_t>(j) + i * bpp,
-                           srcBuf.GetRowAs<uint8_t>(j + y0) + (i + x0) * bpp,
-                           width * bpp);
+                memcpy(destRows.GetRow(j), srcRows.GetRow(j + y0) + x0 * bpp, width * bpp);
 
             return result;
         }
@@ -491,12 +490,16 @@ static c_SimpleBuffer GetConvertedPixelFormatFragment(
     int inPtrStep = srcBuf.GetBytesPerPixel(),
         outPtrStep = BytesPerPixel[static_cast<size_t>(destPixFmt)];
 
+    const c_TypedView<const uint8_t> srcRows(srcBuf);
+    const c_TypedView<uint8_t> destRows(destBuf);
+    const PixelFormat srcPixFmt = srcBuf.GetPixelFormat();
+
     for (unsigned j = 0; j < height; j++)
     {
-        const uint8_t* inPtr = srcBuf.GetRowAs<uint8_t>(j + y0) + x0 * srcBuf.GetBytesPerPixel();
-        uint8_t* outPtr = destBuf.GetRowAs<uint8_t>(j);
+        const uint8_t* inPtr = srcRows.GetRow(j + y0) + x0 * inPtrStep;
+        uint8_t* outPtr = destRows.GetRow(j);
 
-        switch (srcBuf.GetPixelFormat())
+        switch (srcPixFmt)
         {
         case PixelFormat::PIX_MONO8: {
             switch (destPixFmt)
@@ -741,9 +744,11 @@ void c_Image::Copy(const c_Image& src, c_Image& dest, unsigned srcX, unsigned sr
 
     int bpp = src.GetBuffer().GetBytesPerPixel();
 
+    const c_TypedView<const uint8_t> srcRows(src);
+    const c_TypedView<uint8_t> destRows(dest);
     for (unsigned y = 0; y < height; y++)
-        memcpy(dest.GetRowAs<uint8_t>(destY + y) + destX * bpp,
-               src.GetRowAs<uint8_t>(srcY + y) + srcX * bpp,
+        memcpy(destRows.GetRow(destY + y) + destX * bpp,
+               srcRows.GetRow(srcY + y) + srcX * bpp,
                width * bpp);
 }
 
@@ -790,6 +795,9 @@ void ResizeAndTranslateImpl(
 
     int bytesPP = srcImg.GetBytesPerPixel();
 
+    const c_TypedView<const uint8_t> srcRows(srcImg);
+    const c_TypedView<uint8_t> destRows(destImg);
+
     // start and end (inclusive) coordinates to fill in the output buffer
     int destXstart = (xOfsInt < 0) ? 0 : xOfsInt;
     int destYstart = (yOfsInt < 0) ? 0 : yOfsInt;
@@ -801,7 +809,7 @@ void ResizeAndTranslateImpl(
     {
         if (clearToZero)
             for (unsigned y = 0; y < destImg.GetHeight(); y++)
-                memset(destImg.GetRow(y), 0, destImg.GetWidth() * bytesPP);
+                memset(destRows.GetRow(y), 0, destImg.GetWidth() * bytesPP);
         return;
     }
 
@@ -809,16 +817,16 @@ void ResizeAndTranslateImpl(
     {
         // Unchanged rows at the top
         for (int y = 0; y < destYstart; y++)
-            memset(destImg.GetRow(y), 0, destImg.GetWidth() * bytesPP);
+            memset(destRows.GetRow(y), 0, destImg.GetWidth() * bytesPP);
         // Unchanged rows at the bottom
         for (unsigned y = destYend + 1; y < destImg.GetHeight(); y++)
-            memset(destImg.GetRow(y), 0, destImg.GetWidth() * bytesPP);
+            memset(destRows.GetRow(y), 0, destImg.GetWidth() * bytesPP);
         for (int y = destYstart; y <= destYend; y++)
         {
             // Columns to the left of the target area
-            memset(destImg.GetRow(y), 0, destXstart*bytesPP);
+            memset(destRows.GetRow(y), 0, destXstart*bytesPP);
             // Columns to the right of the target area
-            memset(destImg.GetRowAs<uint8_t>(y) + (destXend+1)*bytesPP, 0, (destImg.GetWidth() - 1 - destXend) * bytesPP);
+            memset(destRows.GetRow(y) + (destXend+1)*bytesPP, 0, (destImg.GetWidth() - 1 - destXend) * bytesPP);
         }
     }
 
@@ -828,8 +836,8 @@ void ResizeAndTranslateImpl(
         for (int y = destYstart; y <= destYend; y++)
         {
             memcpy(
-                destImg.GetRowAs<uint8_t>(y) + destXstart * bytesPP,
-                srcImg.GetRowAs<uint8_t>(y - yOfsInt + srcYmin) + (destXstart - xOfsInt + srcXmin) * bytesPP,
+                destRows.GetRow(y) + destXstart * bytesPP,
+                srcRows.GetRow(y - yOfsInt + srcYmin) + (destXstart - xOfsInt + srcXmin) * bytesPP,
                 (destXend - destXstart + 1) * bytesPP
             );
         }
@@ -844,12 +852,12 @@ void ResizeAndTranslateImpl(
         // 2 top and 2 bottom rows
         for (int i = 0; i < 2; i++)
         {
-            memcpy(destImg.GetRowAs<uint8_t>(destYstart + i) + destXstart*bytesPP,
-                   srcImg.GetRowAs<uint8_t>(destYstart + i - yOfsInt + srcYmin) + (destXstart - xOfsInt + srcXmin) * bytesPP,
+            memcpy(destRows.GetRow(destYstart + i) + destXstart*bytesPP,
+                   srcRows.GetRow(destYstart + i - yOfsInt + srcYmin) + (destXstart - xOfsInt + srcXmin) * bytesPP,
                    (destXend - destXstart + 1) * bytesPP);
 
-            memcpy(destImg.GetRowAs<uint8_t>(destYend - i) + destXstart*bytesPP,
-                srcImg.GetRowAs<uint8_t>(destYend - i - yOfsInt + srcYmin) + (destXstart - xOfsInt + srcXmin) * bytesPP,
+            memcpy(destRows.GetRow(destYend - i) + destXstart*bytesPP,
+                srcRows.GetRow(destYend - i - yOfsInt + srcYmin) + (destXstart - xOfsInt + srcXmin) * bytesPP,
                 (destXend - destXstart + 1) * bytesPP);
         }
 
@@ -857,13 +865,13 @@ void ResizeAndTranslateImpl(
         for (int y = destYstart; y <= destYend; y++)
         {
             // 2 leftmost columns
-            memcpy(destImg.GetRowAs<uint8_t>(y) + destXstart*bytesPP,
-                   srcImg.GetRowAs<uint8_t>(y - yOfsInt + srcYmin) + (destXstart - xOfsInt + srcXmin)*bytesPP,
+            memcpy(destRows.GetRow(y) + destXstart*bytesPP,
+                   srcRows.GetRow(y - yOfsInt + srcYmin) + (destXstart - xOfsInt + srcXmin)*bytesPP,
                    2 * bytesPP); // copy 2 pixels
 
             // 2 rightmost columns
-            memcpy(destImg.GetRowAs<uint8_t>(y) + (destXend-1)*bytesPP,
-                   srcImg.GetRowAs<uint8_t>(y - yOfsInt + srcYmin) + (destXend - 1 - xOfsInt + srcXmin)*bytesPP,
+            memcpy(destRows.GetRow(y) + (destXend-1)*bytesPP,
+                   srcRows.GetRow(y - yOfsInt + srcYmin) + (destXend - 1 - xOfsInt + srcXmin)*bytesPP,
                    2 * bytesPP); // copy 2 pixels
         }
 
@@ -898,10 +906,15 @@ void ResizeAndTranslateImpl(
 
         int numChannels = NumChannels[static_cast<size_t>(srcImg.GetPixelFormat())];
 
+        const c_TypedView<const Lum_t> srcValues(srcImg);
+        const c_TypedView<Lum_t> destValues(destImg);
+
         // Skip 2-pixels borders on each side of the image
         #pragma omp parallel for
         for (int row = destYstart+2; row <= destYend-2; row++)
         {
+            Lum_t* destRow = destValues.GetRow(row);
+
             for (int col = destXstart+2; col <= destXend-2; col++)
             {
                 for (int ch = 0; ch < numChannels; ch++)
@@ -909,23 +922,22 @@ void ResizeAndTranslateImpl(
                     float yvals[4];
 
                     // Perform 4 interpolations at 4 adjacent rows, using X offsets -1, 0, 1, 2 (*idx)
-                    int y = row - idy;
-                    int srcY = y - yOfsInt + srcYmin;
+                    int srcY = row - idy - yOfsInt + srcYmin;
+                    const int srcX = col - xOfsInt + srcXmin;
                     for (int relY = -1; relY <= 2; relY++)
                     {
-                        int srcX = col - xOfsInt + srcXmin;
+                        const Lum_t* srcRow = srcValues.GetRow(srcY);
                         yvals[relY+1] = InterpolateCubic(xOfsFrac,
-                            srcImg.GetRowAs<Lum_t>(srcY)[(srcX - idx)*numChannels + ch],
-                            srcImg.GetRowAs<Lum_t>(srcY)[(srcX      )*numChannels + ch],
-                            srcImg.GetRowAs<Lum_t>(srcY)[(srcX + idx)*numChannels + ch],
-                            srcImg.GetRowAs<Lum_t>(srcY)[(srcX + idx + idx)*numChannels + ch]);
+                            srcRow[(srcX - idx)*numChannels + ch],
+                            srcRow[(srcX      )*numChannels + ch],
+                            srcRow[(srcX + idx)*numChannels + ch],
+                            srcRow[(srcX + idx + idx)*numChannels + ch]);
 
-                        y += idy;
                         srcY += idy;
                     }
 
                     // Perform the final vertical (column) interpolation of the 4 horizontal (row) values interpolated previously
-                    destImg.GetRowAs<Lum_t>(row)[col*numChannels + ch] = static_cast<Lum_t>(ClampLuminance(InterpolateCubic(yOfsFrac, yvals[0], yvals[1], yvals[2], yvals[3]), maxLum));
+                    destRow[col*numChannels + ch] = static_cast<Lum_t>(ClampLuminance(InterpolateCubic(yOfsFrac, yvals[0], yvals[1], yvals[2], yvals[3]), maxLum));
                 }
             }
         }
@@ -971,33 +983,19 @@ void c_Image::ResizeAndTranslate(
 
 void NormalizeFpImage(c_Image& img, float minLevel, float maxLevel)
 {
-    float lmin = FLT_MAX, lmax = -FLT_MAX; // min and max brightness in the input image
-    for (unsigned row = 0; row < img.GetHeight(); row++)
-        for (unsigned col = 0; col < img.GetWidth(); col++)
-        {
-            float val = img.GetRowAs<float>(row)[col];
-            if (val < lmin)
-                lmin = val;
-            if (val > lmax)
-                lmax = val;
-        }
+    IMPPG_ASSERT(img.GetPixelFormat() == PixelFormat::PIX_MONO32F);
+    const c_TypedView<float> pixels(img);
+    const c_PaddedArrayPtr<float> pixelsArray = ToPaddedArray(pixels);
+
+    // min and max brightness in the input image
+    const auto [lmin, lmax] = FindMinMax(ToPaddedArray(c_TypedView<const float>(img)));
 
     // Determine coefficients 'a' and 'b' which satisfy: new_luminance := a * old_luminance + b
     float a = (maxLevel - minLevel) / (lmax - lmin);
     float b = maxLevel - a*lmax;
 
     // Pixels with brightness 'minLevel' become black and those of 'maxLevel' become white.
-
-    for (unsigned row = 0; row < img.GetHeight(); row++)
-        for (unsigned col = 0; col < img.GetWidth(); col++)
-        {
-            float& val = img.GetRowAs<float>(row)[col];
-            val = a * val + b;
-            if (val < 0.0f)
-                val = 0.0f;
-            else if (val > 1.0f)
-                val = 1.0f;
-        }
+    AffineTransformArray(pixelsArray, a, b);
 }
 
 #if USE_CFITSIO
@@ -1275,13 +1273,9 @@ void c_Image::Multiply(const c_Image& mult)
     IMPPG_ASSERT(GetPixelFormat() == PixelFormat::PIX_MONO32F && mult.GetPixelFormat() == PixelFormat::PIX_MONO32F);
     IMPPG_ASSERT(GetWidth() == mult.GetWidth() && GetHeight() == mult.GetHeight());
 
-    for (unsigned row = 0; row < GetHeight(); row++)
-    {
-        const float* src_row = mult.GetRowAs<float>(row);
-        float* dest_row = GetRowAs<float>(row);
-        for (unsigned col = 0; col < GetWidth(); col++)
-            dest_row[col] *= src_row[col];
-    }
+    const c_TypedView<float> values(*this);
+    const c_TypedView<const float> factors(mult);
+    MultiplyArrays(ToPaddedArray(values), ToPaddedArray(factors));
 }
 
 /// Returns 'true' if image's width and height were successfully read; returns 'false' on error
@@ -35,6 +35,7 @@ File description:
 #include <wx/dcclient.h>
 #include <wx/dcmemory.h>
 #include <wx/filedlg.h>
+#include <wx/filepicker.h>
 #include <wx/filename.h>
 #include <wx/image.h>
 #include <wx/intl.h>
@@ -140,6 +141,9 @@ BEGIN_EVENT_TABLE(c_MainWindow, wxFrame)
 
     EVT_MENU(ID_BatchProcessing, c_MainWindow::OnCommandEvent)
     EVT_CHECKBOX(ID_LucyRichardsonDeringing, c_MainWindow::OnCommandEvent)
+    EVT_CHECKBOX(ID_LucyRichardsonAccelerated, c_MainWindow::OnCommandEvent)
+    EVT_CHECKBOX(ID_LucyRichardsonMeasuredPsf, c_MainWindow::OnCommandEvent)
+    EVT_FILEPICKER_CHANGED(ID_LucyRichardsonPsfFile, c_MainWindow::OnLucyRichardsonPsfFile)
     EVT_MENU(ID_NormalizeImage, c_MainWindow::OnCommandEvent)
     EVT_MENU(ID_ChooseLanguage, c_MainWindow::OnCommandEvent)
     EVT_MENU(ID_ToneCurveWindowSettings, c_MainWindow::OnCommandEvent)
@@ -204,6 +208,9 @@ void c_MainWindow::LoadSettingsFromFile(wxString settingsFile, bool moveToMruLis
         m_Ctrls.lrSigma->SetValue(s.processing.LucyRichardson.sigma);
         m_Ctrls.lrIters->SetValue(s.processing.LucyRichardson.iterations);
         m_Ctrls.lrDeriging->SetValue(s.processing.LucyRichardson.deringing.enabled);
+        m_Ctrls.lrAccelerated->SetValue(s.processing.LucyRichardson.accelerated);
+        m_Ctrls.lrMeasuredPsf->SetValue(s.processing.LucyRichardson.measuredPsf.enabled);
+        m_Ctrls.lrPsfFile->SetPath(wxString::FromUTF8(s.processing.LucyRichardson.measuredPsf.fileName));
 
         m_Ctrls.unshAdaptive->SetValue(s.processing.unsharpMasking.adaptive);
         m_Ctrls.unshSigma->SetValue(s.processing.unsharpMasking.sigma);
@@ -492,6 +499,12 @@ void c_MainWindow::OnLucyRichardsonIters(wxSpinEvent&)
     IndicateSettingsModified();
 }
 
+void c_MainWindow::OnLucyRichardsonPsfFile(wxFileDirPickerEvent&)
+{
+    OnUpdateLucyRichardsonSettings();
+    IndicateSettingsModified();
+}
+
 void c_MainWindow::OnCloseToneCurveEditorWindow(wxCloseEvent& event)
 {
     if (event.CanVeto())
@@ -550,6 +563,9 @@ c_MainWindow::c_MainWindow()
     s.processing.LucyRichardson.sigma = Default::LR_SIGMA;
     s.processing.LucyRichardson.iterations = Default::LR_ITERATIONS;
     s.processing.LucyRichardson.deringing.enabled = false;
+    s.processing.LucyRichardson.accelerated = false;
+    s.processing.LucyRichardson.convergenceStop.enabled = false;
+    s.processing.LucyRichardson.measuredPsf.enabled = false;
 
     s.processing.unsharpMasking.adaptive = false;
     s.processing.unsharpMasking.sigma = Default::UNSHMASK_SIGMA;
@@ -1005,6 +1021,9 @@ void c_MainWindow::OnUpdateLucyRichardsonSettings()
     proc.LucyRichardson.iterations = m_Ctrls.lrIters->GetValue();
     proc.LucyRichardson.sigma = m_Ctrls.lrSigma->GetValue();
     proc.LucyRichardson.deringing.enabled = m_Ctrls.lrDeriging->GetValue();
+    proc.LucyRichardson.accelerated = m_Ctrls.lrAccelerated->GetValue();
+    proc.LucyRichardson.measuredPsf.enabled = m_Ctrls.lrMeasuredPsf->GetValue();
+    proc.LucyRichardson.measuredPsf.fileName = m_Ctrls.lrPsfFile->GetPath().ToUTF8();
 
     m_BackEnd->LRSettingsChanged(proc);
 }
@@ -1106,6 +1125,8 @@ void c_MainWindow::OnCommandEvent(wxCommandEvent& event)
     case ID_LucyRichardsonIters: // happens only if Enter pressed in the text control
     case ID_LucyRichardsonSigma:
     case ID_LucyRichardsonDeringing:
+    case ID_LucyRichardsonAccelerated:
+    case ID_LucyRichardsonMeasuredPsf:
         OnUpdateLucyRichardsonSettings();
         IndicateSettingsModified();
         break;
@@ -1323,6 +1344,17 @@ wxPanel* c_MainWindow::CreateLucyRichardsonControlsPanel(wxWindow* parent)
     szTop->Add(m_Ctrls.lrDeriging = new wxCheckBox(result, ID_LucyRichardsonDeringing, _("Prevent ringing")), 0, wxALIGN_LEFT | wxALL, BORDER);
     m_Ctrls.lrDeriging->SetToolTip(_("Prevents ringing (halo) around overexposed areas, e.g. a solar disc in a prominence image (experimental feature)."));
 
+    szTop->Add(m_Ctrls.lrAccelerated = new wxCheckBox(result, ID_LucyRichardsonAccelerated, _("Accelerated")), 0, wxALIGN_LEFT | wxALL, BORDER);
+    m_Ctrls.lrAccelerated->SetToolTip(_(L"Reaches the sharpness of the specified number of iterations in fewer ones (e.g. 16 instead of 60). "
+        L"Used only by the CPU + bitmaps back end."));
+
+    szTop->Add(m_Ctrls.lrMeasuredPsf = new wxCheckBox(result, ID_LucyRichardsonMeasuredPsf, _("Measured PSF")), 0, wxALIGN_LEFT | wxALL, BORDER);
+    m_Ctrls.lrMeasuredPsf->SetToolTip(_("Deconvolves with the point spread function loaded from an image (e.g. of a star in the middle of it) "
+        "instead of the Gaussian one. Used only by the CPU + bitmaps back end."));
+    szTop->Add(m_Ctrls.lrPsfFile = new wxFilePickerCtrl(result, ID_LucyRichardsonPsfFile, wxEmptyString, _("Choose the PSF image"),
+        INPUT_FILE_FILTERS, wxDefaultPosition, wxDefaultSize, wxFLP_OPEN | wxFLP_FILE_MUST_EXIST | wxFLP_USE_TEXTCTRL),
+        0, wxGROW | wxALL, BORDER);
+
     wxSizer *szButtons = new wxBoxSizer(wxHORIZONTAL);
     szButtons->Add(new wxButton(result, ID_LucyRichardsonReset, _("reset"), wxDefaultPosition, wxDefaultSize, wxBU_EXACTFIT),
         0, wxALIGN_CENTER_VERTICAL | wxALL, BORDER);
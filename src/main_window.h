@@ -32,6 +32,7 @@ File description:
 #include <wx/bitmap.h>
 #include <wx/dc.h>
 #include <wx/event.h>
+#include <wx/filepicker.h>
 #include <wx/frame.h>
 #include <wx/intl.h>
 #include <wx/panel.h>
@@ -62,6 +63,7 @@ class c_MainWindow: public wxFrame
     void OnToneCurveChanged(wxCommandEvent& event);
     void OnCloseToneCurveEditorWindow(wxCloseEvent& event);
     void OnLucyRichardsonIters(wxSpinEvent& event);
+    void OnLucyRichardsonPsfFile(wxFileDirPickerEvent& event);
     void OnImageViewMouseCaptureLost(wxMouseCaptureLostEvent& event);
     void OnAuiPaneClose(wxAuiManagerEvent& event);
     void OnImageViewMouseWheel(wxMouseEvent& event);
@@ -129,6 +131,9 @@ class c_MainWindow: public wxFrame
         c_NumericalCtrl* lrSigma{nullptr};
         wxSpinCtrl* lrIters{nullptr};
         wxCheckBox* lrDeriging{nullptr};
+        wxCheckBox* lrAccelerated{nullptr};
+        wxCheckBox* lrMeasuredPsf{nullptr};
+        wxFilePickerCtrl* lrPsfFile{nullptr};
         wxCheckBox* unshAdaptive{nullptr};
 
         c_NumericalCtrl* unshSigma{nullptr};
@@ -23,21 +23,89 @@ File description:
 
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 enum class ConvolutionMethod
 {
-    AUTO,           ///< Automatically select STANDARD or YOUNG_VAN_VLIET depending on "sigma"
+    AUTO,           ///< Automatically select STANDARD, YOUNG_VAN_VLIET or STACKED_BOX depending on "sigma"
     STANDARD,       ///< Standard iterative convolution using 1D kernel projection (1D convolution of rows and columns)
-    YOUNG_VAN_VLIET ///< Young & van Vliet recursive Gaussian convolution
+    YOUNG_VAN_VLIET, ///< Young & van Vliet recursive Gaussian convolution
+    STACKED_BOX     ///< Approximation with successive box filters (running sums); cost does not depend on sigma
 };
 
-/** Minimum radius in pixels (= ceil(3*sigma)) of the Gaussian kernel for which
+/** Default minimum radius in pixels (= ceil(3*sigma)) of the Gaussian kernel for which
     the Young & van Vliet recursive convolution is to be used. Below that,
     the standard iterative implementation is currently faster (as tested on my
-    Core i5-3570K with DDR3 PC-10700 RAM, compiled with MS C++ 18.00, for 1-4 threads - Filip). */
+    Core i5-3570K with DDR3 PC-10700 RAM, compiled with MS C++ 18.00, for 1-4 threads - Filip).
+    The value actually used is measured with 'CalibrateYoungVanVlietMinKernelRadius' (see 'SetYoungVanVlietMinKernelRadius'). */
 constexpr int YOUNG_VAN_VLIET_MIN_KERNEL_RADIUS = 8;
 
+/// Minimum kernel radius checked (and returned) by 'CalibrateYoungVanVlietMinKernelRadius'; below it, the timings
+/// are too short to be reliable and the standard convolution is assumed to be faster.
+constexpr int CONVOLUTION_CALIBRATION_MIN_KERNEL_RADIUS = YOUNG_VAN_VLIET_MIN_KERNEL_RADIUS / 2;
+
+/// Maximum kernel radius checked by 'CalibrateYoungVanVlietMinKernelRadius'.
+constexpr int CONVOLUTION_CALIBRATION_MAX_KERNEL_RADIUS = 32;
+
+/// Sides of the square test images used by 'CalibrateYoungVanVlietMinKernelRadius' for each image size class.
+/** The method selection is calibrated separately for each class, as the break-even kernel radius depends
+    on the image size (e.g. 4-6 for 256x256, 16-17 for 1024x1024). An image belongs to the class whose
+    test image has the nearest number of pixels (on a logarithmic scale). */
+constexpr std::array<int, 3> CONVOLUTION_CALIBRATION_IMAGE_SIZES{256, 1024, 2048};
+
+constexpr int NUM_CONVOLUTION_SIZE_CLASSES = static_cast<int>(CONVOLUTION_CALIBRATION_IMAGE_SIZES.size());
+
+/// Returns the size class (index in CONVOLUTION_CALIBRATION_IMAGE_SIZES) of an image.
+int GetConvolutionSizeClass(int width, int height);
+
+/// Returns the minimum kernel radius for which ConvolutionMethod::AUTO selects YOUNG_VAN_VLIET for images
+/// of the specified size class; 0 if not calibrated yet.
+int GetYoungVanVlietMinKernelRadius(int sizeClass);
+
+/// Sets the minimum kernel radius for which ConvolutionMethod::AUTO selects YOUNG_VAN_VLIET for images
+/// of the specified size class.
+/** If 'radius' is 0, the class is calibrated with 'CalibrateYoungVanVlietMinKernelRadius' when ConvolutionMethod::AUTO
+    is first used for such an image (i.e. on the thread which prepares the convolution). */
+void SetYoungVanVlietMinKernelRadius(int sizeClass, int radius);
+
+/// Returns the number of threads used for convolution.
+int GetConvolutionNumThreads();
+
+/// Times STANDARD and YOUNG_VAN_VLIET convolution using the current number of threads.
+/** Returns the smallest kernel radius for which YOUNG_VAN_VLIET is faster, also for the next radius (so that
+    a single noisy measurement does not decide). The result is between CONVOLUTION_CALIBRATION_MIN_KERNEL_RADIUS
+    and CONVOLUTION_CALIBRATION_MAX_KERNEL_RADIUS + 1; it is not applied automatically. */
+int CalibrateYoungVanVlietMinKernelRadius(
+    int width, ///< Width of the test image
+    int height ///< Height of the test image
+);
+
+/** Minimum sigma for which the stacked box filter approximation is to be used instead of the Young & van Vliet
+    method. Measured on a 2048x2048 image against an exact Gaussian: for sigma 7-10 the stacked box filter
+    has 1.4-2.4x smaller RMS error than Young & van Vliet and takes about as long as the standard convolution
+    (25 ms vs. 15 ms for Young & van Vliet); it has to be below MAX_GAUSSIAN_SIGMA to be selected by AUTO at all. */
+constexpr float STACKED_BOX_MIN_SIGMA = 8.0f;
+
+/// Number of box filters used to approximate a Gaussian in 'ConvolveStackedBox'.
+constexpr int STACKED_BOX_NUM_BOXES = 4;
+
+/// Added to the divisor by ConvolutionEpilogue::DIVIDE_INTO to prevent division by zero
+/// and propagation of NaNs across output pixels.
+constexpr float CONVOLUTION_DIVISION_EPSILON = 1.0e-8f;
+
+/// Element-wise operation applied to convolution results before they are stored.
+/** Saves the caller a separate pass over the output. */
+enum class ConvolutionEpilogue
+{
+    NONE,
+    DIVIDE_INTO, ///< output = operand / (result + CONVOLUTION_DIVISION_EPSILON)
+    MULTIPLY     ///< output = operand * result
+};
+
 /// Wrapper for an array which may contain row padding. Stores only the pointer and dimensions; can be copied, deleted without influencing the allocated memory.
 template<typename T>
 class c_PaddedArrayPtr
@@ -67,6 +135,72 @@ public:
     int GetBytesPerRow() const { return m_BytesPerRow; }
 };
 
+/// Returns the addresses of the first byte of 'array' and of the byte following its last element.
+template<typename T>
+std::pair<std::uintptr_t, std::uintptr_t> GetByteRange(c_PaddedArrayPtr<T> array)
+{
+    if (array.width() <= 0 || array.height() <= 0)
+        return { 0, 0 };
+
+    const auto rowAddress = [&array](int row) {
+        if constexpr (std::is_const_v<T>)
+            return reinterpret_cast<std::uintptr_t>(array.row_const(row));
+        else
+            return reinterpret_cast<std::uintptr_t>(array.row(row));
+    };
+    std::uintptr_t first = rowAddress(0);
+    std::uintptr_t last = rowAddress(array.height() - 1);
+    if (last < first) // negative row stride
+        std::swap(first, last);
+
+    return { first, last + array.width() * sizeof(T) };
+}
+
+/// Returns true if the byte ranges (see 'GetByteRange') of 'array1' and 'array2' intersect.
+template<typename T1, typename T2>
+bool Overlap(c_PaddedArrayPtr<T1> array1, c_PaddedArrayPtr<T2> array2)
+{
+    const auto [begin1, end1] = GetByteRange(array1);
+    const auto [begin2, end2] = GetByteRange(array2);
+    return begin1 < end2 && begin2 < end1;
+}
+
+/// Array of floats surrounded by a halo of replicated border values.
+/** Allows a convolution to read up to 'halo' elements beyond each border without clamping coordinates.
+    After the interior is modified, the halo has to be updated with 'FillHalo'. */
+class c_HaloImage
+{
+    int m_Width{0}, m_Height{0}, m_Halo{0};
+    int m_Stride{0}; ///< Number of elements per row (including the halo)
+    std::vector<float> m_Pixels;
+
+public:
+    c_HaloImage() = default;
+
+    c_HaloImage(int width, int height, int halo) { Resize(width, height, halo); }
+
+    /// Changes the dimensions; the contents become undefined. Memory is reallocated only if needed.
+    void Resize(int width, int height, int halo);
+
+    /// Sets the halo elements to the values of the nearest border elements.
+    void FillHalo();
+
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+    int GetHalo() const { return m_Halo; }
+
+    /// Returns the interior (the halo can be accessed via negative and past-the-end coordinates).
+    c_PaddedArrayPtr<float> GetInterior()
+    {
+        return c_PaddedArrayPtr<float>(m_Pixels.data() + m_Halo * m_Stride + m_Halo, m_Width, m_Height, m_Stride * sizeof(float));
+    }
+
+    c_PaddedArrayPtr<const float> GetInterior() const
+    {
+        return c_PaddedArrayPtr<const float>(m_Pixels.data() + m_Halo * m_Stride + m_Halo, m_Width, m_Height, m_Stride * sizeof(float));
+    }
+};
+
 /// Calculates convolution of 'input' with a Gaussian kernel
 void ConvolveSeparable(
     c_PaddedArrayPtr<const float> input, ///< Input array.
@@ -74,77 +208,128 @@ void ConvolveSeparable(
     float sigma                          ///< Gaussian sigma.
 );
 
-/// Calculates convolution of 'input' with a rotationally symmetric and separable (i.e. Gaussian) 'kernel' and writes it in transposed form to 'output'
-void ConvolveSeparableTranspose(
+/// Calculates convolution of 'input' with a rotationally symmetric and separable (i.e. Gaussian) 'kernel'.
+/** The image is processed in tiles of CONVOLUTION_TILE_WIDTH x CONVOLUTION_TILE_HEIGHT pixels (in parallel);
+    each tile's horizontal pass (with vertical halo) and vertical pass are performed while it stays in cache.
+    The vertical pass walks the rows in order and is vectorized across columns, so no transposition is needed. */
+void ConvolveSeparable(
+    c_PaddedArrayPtr<const float> input,  ///< Input array
+    c_PaddedArrayPtr<float> output, ///< Output array having as much rows and columns as 'input' does; must not overlap 'input'
+    const float kernel[], ///< Contains convolution kernel's projection (horizontal/vertical); element [kernelRadius-1] is the middle
+    int kernelRadius ///< 'kernel' contains 2*kernelRadius-1 elements
+);
+
+/// Calculates convolution like the function above, but takes the values beyond the borders from the halo of 'input'.
+/** There is no special handling of the border tiles: every tile is processed by the same branch-free code. */
+void ConvolveSeparable(
+    const c_HaloImage& input, ///< Input array; its halo must be at least 'kernelRadius'-1 and filled
+    c_PaddedArrayPtr<float> output, ///< Output array having as much rows and columns as 'input' does; must not overlap 'input'
+    const float kernel[], ///< Contains convolution kernel's projection (horizontal/vertical); element [kernelRadius-1] is the middle
+    int kernelRadius ///< 'kernel' contains 2*kernelRadius-1 elements
+);
+
+/// Calculates convolution of 'input' with an approximated Gaussian kernel (Young & van Vliet recursive method).
+/** Rows are filtered from 'input' to 'output', then columns of 'output' are filtered in place. */
+void ConvolveGaussianRecursive(
     c_PaddedArrayPtr<const float> input,  ///< Input array
-    c_PaddedArrayPtr<float> output, ///< Transposed output array; contains as many rows as 'input' does columns and as many columns as 'input' does rows
-    const float kernel[], ///< Contains convolution kernel's projection (horizontal/vertical); element [kernelRadius] is the middle
-    int kernelRadius, ///< 'kernel' contains 2*kernelRadius-1 elements
-    float tempBuf1[], ///< Temporary buffer 1, as many elements as 'input'
-    float tempBuf2[] ///< Temporary buffer 2, as many elements as 'input'
+    c_PaddedArrayPtr<float> output,       ///< Output array having as much rows and columns as 'input' does; may equal 'input'
+    float sigma                           ///< Gaussian sigma
 );
 
-/// Calculates convolution of 'input' with an approximated Gaussian kernel (Young & van Vliet recursive method) and writes it in transposed form to 'output'
-void ConvolveGaussianRecursiveTranspose(
+/// Calculates an approximation of convolution of 'input' with a Gaussian kernel by applying STACKED_BOX_NUM_BOXES box filters.
+/** Each box filter is evaluated with running sums, so the cost per pixel does not depend on 'sigma'.
+    Rows are filtered from 'input' to 'output', then columns of 'output' are filtered in place. */
+void ConvolveStackedBox(
     c_PaddedArrayPtr<const float> input,  ///< Input array
-    c_PaddedArrayPtr<float> output,       ///< Transposed output array; contains as many rows as 'input' does columns and as many columns as 'input' does rows
-    float sigma,                          ///< Gaussian sigma
-    float tempBuf1[],                     ///< width*height elements
-    float tempBuf2[]                      ///< width*height elements
+    c_PaddedArrayPtr<float> output,       ///< Output array having as much rows and columns as 'input' does; may equal 'input'
+    float sigma                           ///< Gaussian sigma
 );
 
-/// Matrices are transposed in square blocks of this length to a side
-constexpr int TRANSPOSITION_BLOCK_SIZE = 16;
+/// Coefficients of the Young & van Vliet recursive Gaussian filter.
+struct YvVCoefficients
+{
+    float b0inv, b1, b2, b3, B;
+};
 
-/// Transposes matrix 'input' and writes it to 'output'
-template<typename T>
-void Transpose(const T* input, T* output,
-    int width, ///< Number of columns in 'input', rows in 'output'
-    int height, ///< Number of rows in 'input', columns in 'output'
-    int inputBytesPerRow, int outputBytesPerRow, int blockSize)
+/// Reusable state for repeated Gaussian convolutions of images of the same size.
+/** Owns the kernel (or the recursive filter's coefficients, or box radii) and the per-thread scratch buffers,
+    so that they are not recalculated and reallocated on every call. Not thread-safe; each concurrently
+    running user needs its own plan (the convolution itself is parallelized internally). */
+class c_ConvolutionPlan
 {
-    // Transpose blocks
-
-    // i, j - indices of the current block
-    for (int j = 0; j < height / blockSize; j++)
-        for (int i = 0; i < width / blockSize; i++)
-        {
-            // Addresses of current input and output blocks
-            const T* inBlk = reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(input) + (i*sizeof(T) + j*inputBytesPerRow) * blockSize);
-            T* outBlk = reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(output) + (j*sizeof(T) + i*outputBytesPerRow) * blockSize);
-
-            // x, y - indices of the current element within the current block
-            for (int y = 0; y < blockSize; y++)
-                for (int x = 0; x < blockSize; x++)
-                {
-                    *reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(outBlk) + y*sizeof(T) + x*outputBytesPerRow) =
-                        *reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(inBlk) + x*sizeof(T) + y*inputBytesPerRow);
-                }
-        }
-
-    // Transpose the remaining elements outside the whole blocks
-
-    // rightmost remaining elements
-    for (int j = 0; j < height - (height % blockSize); j++)
-        for (int i = width - (width % blockSize); i < width; i++)
-        {
-            *reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(output) + j*sizeof(T) + i*outputBytesPerRow) =
-                *reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(input) + i*sizeof(T) + j*inputBytesPerRow);
-        }
-
-    // bottommost remaining elements
-    for (int j = 0; j < width - (width % blockSize); j++)
-        for (int i = height - (height % blockSize); i < height; i++)
-        {
-            *reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(output) + i*sizeof(T) + j*outputBytesPerRow) =
-                *reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(input) + j*sizeof(T) + i*inputBytesPerRow);
-        }
-
-    // bottom-right residual rectangle
-    for (int j = height - (height % blockSize); j < height; j++)
-        for (int i = width - (width % blockSize); i < width; i++)
-        {
-            *reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(output) + j*sizeof(T) + i*outputBytesPerRow) =
-                *reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(input) + i*sizeof(T) + j*inputBytesPerRow);
-        }
-}
+public:
+    c_ConvolutionPlan() = default;
+
+    c_ConvolutionPlan(int width, int height, float sigma, ConvolutionMethod method = ConvolutionMethod::AUTO)
+    {
+        Prepare(width, height, sigma, method);
+    }
+
+    /// Prepares the plan for the specified parameters; does nothing if they are the same as the current ones.
+    void Prepare(int width, int height, float sigma, ConvolutionMethod method = ConvolutionMethod::AUTO);
+
+    bool IsPreparedFor(int width, int height, float sigma, ConvolutionMethod method = ConvolutionMethod::AUTO) const
+    {
+        return m_Width == width && m_Height == height && m_Sigma == sigma && m_RequestedMethod == method;
+    }
+
+    /// Convolves 'input' (of the size specified in 'Prepare') and writes the result to 'output'.
+    void Execute(
+        c_PaddedArrayPtr<const float> input, ///< Input array
+        c_PaddedArrayPtr<float> output       ///< Output array having as much rows and columns as 'input' does; must not overlap 'input'
+    );
+
+    /// Convolves 'input' like the function above; if the method is STANDARD, the values beyond the borders
+    /// are taken from the halo of 'input' (which must be at least 'GetRequiredHalo' and filled).
+    void Execute(const c_HaloImage& input, c_PaddedArrayPtr<float> output);
+
+    /// Convolves 'input' like the function above and combines the results with 'operand' as specified by 'epilogue'.
+    void Execute(
+        const c_HaloImage& input,
+        c_PaddedArrayPtr<float> output,
+        ConvolutionEpilogue epilogue,
+        c_PaddedArrayPtr<const float> operand ///< Has as many rows and columns as 'input'; must not overlap 'output'
+    );
+
+    /// Convolves 'input' like 'Execute', but only in the tiles (of CONVOLUTION_TILE_WIDTH x CONVOLUTION_TILE_HEIGHT pixels)
+    /// containing a nonzero element of 'mask'; the other tiles of 'output' are left unchanged.
+    /** Only the STANDARD method (whose kernel has finite support) skips tiles; other methods convolve the whole image. */
+    void ExecuteMasked(
+        c_PaddedArrayPtr<const float> input,
+        c_PaddedArrayPtr<float> output,
+        c_PaddedArrayPtr<const std::uint8_t> mask ///< Has as many rows and columns as 'input'
+    );
+
+    /// Returns the method actually used (i.e. never AUTO).
+    ConvolutionMethod GetMethod() const { return m_Method; }
+
+    /// Returns the halo size of input used by 'Execute' with a 'c_HaloImage'.
+    int GetRequiredHalo() const { return (m_Method == ConvolutionMethod::STANDARD) ? m_KernelRadius - 1 : 0; }
+
+private:
+    void ExecuteImpl(
+        c_PaddedArrayPtr<const float> input,
+        bool inputHasHalo,
+        c_PaddedArrayPtr<float> output,
+        ConvolutionEpilogue epilogue,
+        c_PaddedArrayPtr<const float> operand
+    );
+
+    int m_Width{0};
+    int m_Height{0};
+    float m_Sigma{0.0f};
+    ConvolutionMethod m_RequestedMethod{ConvolutionMethod::AUTO};
+    ConvolutionMethod m_Method{ConvolutionMethod::STANDARD};
+
+    std::vector<float> m_Kernel; ///< Used by STANDARD; contains 2*m_KernelRadius-1 elements
+    int m_KernelRadius{0};
+    YvVCoefficients m_YvVCoefficients{}; ///< Used by YOUNG_VAN_VLIET
+    std::vector<int> m_BoxRadii; ///< Used by STACKED_BOX
+
+    std::vector<std::vector<float>> m_ThreadBuffers; ///< Scratch buffers; element [i] is used by the OpenMP thread no. i
+};
+
+/// Tile size used by 'ConvolveSeparable'. Together with the halo, the per-thread tile buffer
+/// takes about 128 KiB for small kernels, i.e. it fits in a typical L2 cache.
+constexpr int CONVOLUTION_TILE_WIDTH = 256;
+constexpr int CONVOLUTION_TILE_HEIGHT = 128;
@@ -0,0 +1,39 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    CPU features detection header.
+*/
+
+#pragma once
+
+/// Instruction set extensions used by the vectorized kernels; each level implies the previous ones.
+enum class SimdLevel
+{
+    SCALAR = 0, ///< No explicit vectorization.
+    SSE4,       ///< SSE 4.1, 4 floats per register.
+    AVX2,       ///< AVX2 + FMA, 8 floats per register.
+    AVX512      ///< AVX-512F, 16 floats per register.
+};
+
+/// Returns the highest instruction set supported both by the current CPU and by the build (detected once, at first call).
+SimdLevel GetSimdLevel();
+
+/// Returns a human-readable name of `level` (e.g. for logging).
+const char* GetSimdLevelName(SimdLevel level);
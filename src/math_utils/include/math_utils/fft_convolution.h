@@ -0,0 +1,109 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Frequency-domain convolution header.
+*/
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "math_utils/convolution.h"
+
+/// Reusable state for repeated convolutions of images of the same size with an arbitrary (e.g. measured) kernel.
+/** The convolution is performed in the frequency domain, so its cost is O(N log N) regardless of the kernel's size.
+    The input is padded (by replicating its border values) to power-of-two dimensions, leaving at least
+    the kernel's radius on each side, so that the cyclic convolution does not wrap around.
+
+    The image is real, so its rows are transformed in pairs (as the real and imaginary parts of a complex row)
+    and only half of its spectrum is stored. The kernel's spectrum is calculated once, in 'Prepare'. The spectrum of the kernel flipped horizontally
+    and vertically is its complex conjugate, so it does not have to be stored separately.
+
+    Not thread-safe; each concurrently running user needs its own instance (the convolution itself
+    is parallelized internally). */
+class c_FFTConvolution
+{
+public:
+    /// Prepares for convolving images of the specified size with 'kernel'; does nothing if they are the same as the current ones.
+    void Prepare(
+        int width, int height,
+        c_PaddedArrayPtr<const float> kernel ///< Has odd width and height; the middle element is the kernel's center
+    );
+
+    bool IsPreparedFor(int width, int height, c_PaddedArrayPtr<const float> kernel) const;
+
+    /// Convolves 'input' (of the size specified in 'Prepare') and writes the result to 'output'.
+    void Execute(
+        c_PaddedArrayPtr<const float> input, ///< Input array
+        c_PaddedArrayPtr<float> output,      ///< Output array having as much rows and columns as 'input' does; may equal 'input'
+        bool flippedKernel                   ///< If true, the kernel flipped horizontally and vertically is used
+    );
+
+    /// Convolves 'input' like the function above and combines the results with 'operand' as specified by 'epilogue'.
+    void Execute(
+        c_PaddedArrayPtr<const float> input,
+        c_PaddedArrayPtr<float> output,
+        bool flippedKernel,
+        ConvolutionEpilogue epilogue,
+        c_PaddedArrayPtr<const float> operand ///< Has as many rows and columns as 'input'; must not overlap 'output'
+    );
+
+private:
+    /// Tables for the radix-2 transform of a single length.
+    struct FFTTables
+    {
+        int length{0};
+        std::vector<int> bitReversed; ///< Element [i] is 'i' with its log2(length) bits reversed
+        std::vector<std::complex<float>> twiddles; ///< Element [k] is exp(-2*pi*i*k/length); contains length/2 elements
+
+        void Prepare(int len);
+    };
+
+    static void TransformLanes(std::complex<float> data[], std::ptrdiff_t stride, int numLanes, const FFTTables& tables, bool inverse);
+
+    /// Transforms two real rows at once, passed as the real and imaginary parts of 'row' (m_PaddedWidth elements; overwritten).
+    /** Writes the non-redundant halves of the rows' spectra (m_SpectrumWidth elements each). */
+    void ForwardRowPair(std::complex<float> row[], std::complex<float> spectrumA[], std::complex<float> spectrumB[]) const;
+
+    /// Performs the inverse of 'ForwardRowPair'; the real rows are returned as the real and imaginary parts of 'row'.
+    void InverseRowPair(const std::complex<float> spectrumA[], const std::complex<float> spectrumB[], std::complex<float> row[]) const;
+
+    /// Performs in-place vertical transform of all columns of 'data' (m_SpectrumWidth x m_PaddedHeight).
+    void TransformColumns(std::complex<float> data[], bool inverse) const;
+
+    int m_Width{0}, m_Height{0};
+    int m_PaddedWidth{0}, m_PaddedHeight{0};
+    int m_SpectrumWidth{0}; ///< Number of stored columns of the spectra; the rest follows from their Hermitian symmetry
+
+    FFTTables m_RowTables;
+    FFTTables m_ColumnTables;
+
+    /// Copy of the kernel specified in 'Prepare'; used to detect changes.
+    std::vector<float> m_Kernel;
+    int m_KernelWidth{0}, m_KernelHeight{0};
+
+    /// Kernel's spectrum, scaled by 1/(m_PaddedWidth * m_PaddedHeight) (i.e. includes the normalization of the inverse transform).
+    std::vector<std::complex<float>> m_KernelSpectrum;
+
+    /// Spectrum of the padded image.
+    std::vector<std::complex<float>> m_Buffer;
+};
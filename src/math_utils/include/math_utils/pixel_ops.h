@@ -0,0 +1,87 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Element-wise (pixel-wise) operations header.
+*/
+
+#pragma once
+
+#include <utility>
+
+#include "math_utils/convolution.h"
+
+/// Value changing from 'valueBelow' to 'valueAbove' along a cubic curve as its argument goes from 'start' to 'end'.
+struct CubicTransition
+{
+    float start, end;
+    float valueBelow; ///< Value for arguments below 'start'
+    float valueAbove; ///< Value for arguments above 'end'
+    float a, b, c, d; ///< Coefficients of the curve a*x^3 + b*x^2 + c*x + d used in [start; end]
+
+    float operator()(float x) const
+    {
+        if (x < start)
+            return valueBelow;
+        else if (x > end)
+            return valueAbove;
+        else
+            return x * (x * (a * x + b) + c) + d;
+    }
+};
+
+// Functions operating on single rows use the vectorized kernels for the highest instruction set
+// supported by the CPU (see 'GetSimdLevel'), but are single-threaded, so that they can be combined
+// in a single pass over an image (while each row is in cache). Functions operating on whole arrays
+// are additionally parallelized with OpenMP.
+//
+// Unless stated otherwise, 'output' may equal 'input'.
+
+/// Sets output[i] = amount * input[i] + (1 - amount) * blurred[i] (i.e. performs unsharp masking).
+void BlendRow(const float input[], const float blurred[], float output[], int length, float amount);
+
+/// Performs the blending like 'BlendRow', with the amount for each element equal to 'amount(steering[i])'.
+void BlendRowAdaptive(
+    const float input[],
+    const float blurred[],
+    const float steering[],
+    float output[],
+    int length,
+    const CubicTransition& amount
+);
+
+/// Clamps the values to [minValue; maxValue]; NaN becomes 'minValue'.
+void ClampRow(const float input[], float output[], int length, float minValue = 0.0f, float maxValue = 1.0f);
+
+/// Maps the values (clamped to [0; 1]) by a piecewise linear function given by a look-up table; 'output' may be the same as 'input'.
+/** [0; 1] is divided into 'numSegments' equal segments; the input x from the i-th segment is mapped to
+    values[i] + (x * numSegments - i) * slopes[i] (typically slopes[i] = values[i + 1] - values[i]). */
+void InterpolateLutRow(const float values[], const float slopes[], int numSegments, const float input[], float output[], int length);
+
+/// Clamps the values of the array to [minValue; maxValue]; NaN becomes 'minValue'.
+void ClampArray(c_PaddedArrayPtr<float> data, float minValue = 0.0f, float maxValue = 1.0f);
+
+/// Multiplies the elements of 'data' by the corresponding elements of 'factor' (which has the same dimensions).
+void MultiplyArrays(c_PaddedArrayPtr<float> data, c_PaddedArrayPtr<const float> factor);
+
+/// Sets the elements of 'data' to a * value + b, clamped to [minValue; maxValue]; NaN becomes 'minValue'.
+void AffineTransformArray(c_PaddedArrayPtr<float> data, float a, float b, float minValue = 0.0f, float maxValue = 1.0f);
+
+/// Returns the minimum and maximum value of a non-empty array.
+std::pair<float, float> FindMinMax(c_PaddedArrayPtr<const float> data);
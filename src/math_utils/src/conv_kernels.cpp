@@ -0,0 +1,342 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Scalar convolution kernels and selection of the vectorized ones.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "conv_kernels.h"
+#include "../../imppg_assert.h"
+
+/// Reference (non-vectorized) implementation of `ConvolutionKernels::convolveRow`.
+static void ConvolveRowSymmetricScalar(const float input[], float output[], int length, const float halfKernel[], int kernelRadius)
+{
+    for (int i = 0; i < length; i++)
+    {
+        float sum = input[i] * halfKernel[0];
+        for (int j = 1; j < kernelRadius; j++)
+            sum += (input[i - j] + input[i + j]) * halfKernel[j];
+
+        output[i] = sum;
+    }
+}
+
+/// Reference (non-vectorized) implementation of `ConvolutionKernels::convolveColumns`.
+static void ConvolveColumnsSymmetricScalar(const float input[], std::ptrdiff_t stride, float output[], int length, const float halfKernel[], int kernelRadius)
+{
+    for (int i = 0; i < length; i++)
+    {
+        float sum = input[i] * halfKernel[0];
+        for (int j = 1; j < kernelRadius; j++)
+            sum += (input[i - j * stride] + input[i + j * stride]) * halfKernel[j];
+
+        output[i] = sum;
+    }
+}
+
+/// Performs a Young & van Vliet approximated recursive Gaussian filtering of values in one direction
+static void YvVFilterValues(
+    const float input[], ///< Input array
+    float output[], ///< Output array (may equal 'input')
+    int length, ///< Number of elements in 'input', 'output'
+    int direction, ///< 1: filter forward, -1: filter backward; if -1, processing starts at the last element
+    const YvVCoefficients& coeffs
+)
+{
+    int startIdx; // Starting index to process (inclusive)
+    int endIdx; // End index to process (exclusive)
+    if (direction == 1)
+    {
+        startIdx = 0;
+        endIdx = length;
+    }
+    else if (direction == -1)
+    {
+        startIdx = length - 1;
+        endIdx = -1;
+    }
+    else
+    {
+        IMPPG_ABORT_MSG("direction must be 1 or -1");
+    }
+
+    float prev1, prev2, prev3; // Previously calculated values
+
+    // Assume that border values extend beyond the array
+    prev1 = prev2 = prev3 = input[startIdx];
+
+    for (int i = startIdx; i != endIdx; i += direction)
+    {
+        float next = coeffs.B * input[i] + (coeffs.b1*prev1 + coeffs.b2*prev2 + coeffs.b3*prev3) * coeffs.b0inv;
+        prev3 = prev2;
+        prev2 = prev1;
+        prev1 = next;
+
+        output[i] = next;
+    }
+}
+
+/// Reference (non-vectorized) implementation of `ConvolutionKernels::filterRowsYvV`.
+static void FilterRowsYvVScalar(
+    const float* const inputRows[], float* const outputRows[], int numRows, int length,
+    const YvVCoefficients& coeffs, float* /*scratch*/)
+{
+    for (int i = 0; i < numRows; i++)
+    {
+        YvVFilterValues(inputRows[i], outputRows[i], length, 1, coeffs);
+        YvVFilterValues(outputRows[i], outputRows[i], length, -1, coeffs);
+    }
+}
+
+/// Applies successively box filters to `length` values with the specified stride; border values are assumed to extend beyond the array.
+static void BoxFilterValues(float values[], std::ptrdiff_t stride, int length, const int radii[], int numBoxes)
+{
+    std::vector<float> input(length);
+    for (int box = 0; box < numBoxes; box++)
+    {
+        for (int i = 0; i < length; i++)
+            input[i] = values[i * stride];
+
+        const int radius = radii[box];
+        for (int i = 0; i < length; i++)
+        {
+            double sum = 0.0;
+            for (int j = -radius; j <= radius; j++)
+                sum += input[std::clamp(i + j, 0, length - 1)];
+
+            values[i * stride] = static_cast<float>(sum / (2 * radius + 1));
+        }
+    }
+}
+
+/// Reference (non-vectorized) implementation of `ConvolutionKernels::boxFilterRows`.
+static void BoxFilterRowsScalar(
+    const float* const inputRows[], float* const outputRows[], int numRows, int length,
+    const int radii[], int numBoxes, float* /*scratch*/)
+{
+    for (int i = 0; i < numRows; i++)
+    {
+        std::copy_n(inputRows[i], length, outputRows[i]);
+        BoxFilterValues(outputRows[i], 1, length, radii, numBoxes);
+    }
+}
+
+/// Reference (non-vectorized) implementation of `ConvolutionKernels::boxFilterColumns`.
+static void BoxFilterColumnsScalar(float data[], int bytesPerRow, int width, int height, const int radii[], int numBoxes, float* /*scratch*/)
+{
+    IMPPG_ASSERT(bytesPerRow % sizeof(float) == 0);
+    for (int x = 0; x < width; x++)
+        BoxFilterValues(data + x, bytesPerRow / sizeof(float), height, radii, numBoxes);
+}
+
+/// Reference (non-vectorized) implementation of `ConvolutionKernels::filterColumnsYvV`.
+static void FilterColumnsYvVScalar(float data[], int bytesPerRow, int width, int height, const YvVCoefficients& coeffs)
+{
+    std::vector<float> column(height);
+    for (int x = 0; x < width; x++)
+    {
+        const auto element = [&](int y) -> float& { return reinterpret_cast<float*>(reinterpret_cast<std::uint8_t*>(data) + y * static_cast<std::ptrdiff_t>(bytesPerRow))[x]; };
+
+        for (int y = 0; y < height; y++)
+            column[y] = element(y);
+
+        YvVFilterValues(column.data(), column.data(), height, 1, coeffs);
+        YvVFilterValues(column.data(), column.data(), height, -1, coeffs);
+
+        for (int y = 0; y < height; y++)
+            element(y) = column[y];
+    }
+}
+
+/// Reference (non-vectorized) implementation of `ConvolutionKernels::applyEpilogue`.
+static void ApplyEpilogueScalar(float data[], const float operand[], int length, ConvolutionEpilogue epilogue)
+{
+    for (int i = 0; i < length; i++)
+    {
+        switch (epilogue)
+        {
+        case ConvolutionEpilogue::DIVIDE_INTO: data[i] = operand[i] / (data[i] + CONVOLUTION_DIVISION_EPSILON); break;
+        case ConvolutionEpilogue::MULTIPLY: data[i] *= operand[i]; break;
+        default: break;
+        }
+    }
+}
+
+const ConvolutionKernels& GetScalarConvolutionKernels()
+{
+    static const ConvolutionKernels kernels{
+        SimdLevel::SCALAR,
+        &ConvolveRowSymmetricScalar,
+        &ConvolveColumnsSymmetricScalar,
+        &FilterRowsYvVScalar,
+        &FilterColumnsYvVScalar,
+        &BoxFilterRowsScalar,
+        &BoxFilterColumnsScalar,
+        &ApplyEpilogueScalar,
+        {}, // no radius-specialized variants
+        {}
+    };
+    return kernels;
+}
+
+#ifndef NDEBUG
+/// Checks the results of vectorized kernels against the scalar ones.
+static void VerifyConvolutionKernels(const ConvolutionKernels& kernels)
+{
+    const ConvolutionKernels& reference = GetScalarConvolutionKernels();
+
+    // Cover the typical L-R radii and lengths which are not multiples of the vector width
+    for (int kernelRadius: { 2, 3, 5, 8, MAX_SPECIALIZED_KERNEL_RADIUS, MAX_SPECIALIZED_KERNEL_RADIUS + 1, 30 })
+    {
+        std::vector<float> halfKernel(kernelRadius);
+        for (int j = 0; j < kernelRadius; j++)
+            halfKernel[j] = 1.0f / (1 + j);
+
+        for (int length: { 1, 7, 33, 150 })
+        {
+            const int margin = kernelRadius - 1;
+            std::vector<float> input(length + 2 * margin);
+            for (size_t i = 0; i < input.size(); i++)
+                input[i] = static_cast<float>((i * 7919) % 113) / 113.0f;
+
+            std::vector<float> expected(length), actual(length);
+            reference.convolveRow(input.data() + margin, expected.data(), length, halfKernel.data(), kernelRadius);
+            kernels.GetConvolveRow(kernelRadius)(input.data() + margin, actual.data(), length, halfKernel.data(), kernelRadius);
+
+            for (int i = 0; i < length; i++)
+                IMPPG_ASSERT(std::abs(expected[i] - actual[i]) <= 1.0e-4f * std::abs(expected[i]) + 1.0e-6f);
+
+            // The same data seen as 2*margin+1 rows, each `length` elements long
+            const int numRows = 2 * margin + 1;
+            std::vector<float> rows(numRows * length);
+            for (size_t i = 0; i < rows.size(); i++)
+                rows[i] = static_cast<float>((i * 7919) % 113) / 113.0f;
+
+            reference.convolveColumns(&rows[margin * length], length, expected.data(), length, halfKernel.data(), kernelRadius);
+            kernels.GetConvolveColumns(kernelRadius)(&rows[margin * length], length, actual.data(), length, halfKernel.data(), kernelRadius);
+
+            for (int i = 0; i < length; i++)
+                IMPPG_ASSERT(std::abs(expected[i] - actual[i]) <= 1.0e-4f * std::abs(expected[i]) + 1.0e-6f);
+        }
+    }
+
+    // Row counts which are not multiples of the vector width, coefficients for sigma = 3
+    const YvVCoefficients coeffs{ 1.0f / 15.5305f, 26.3887f, -15.8041f, 3.36767f, 0.101625f };
+    for (int numRows: { 1, 5, 19, 70 })
+    {
+        const int length = 45;
+        std::vector<float> input(numRows * length);
+        for (size_t i = 0; i < input.size(); i++)
+            input[i] = static_cast<float>((i * 7919) % 113) / 113.0f;
+
+        std::vector<float> expected(input.size()), actual(input.size()), scratch(length * MAX_SIMD_WIDTH);
+        std::vector<const float*> inputRows(numRows);
+        std::vector<float*> expectedRows(numRows), actualRows(numRows);
+        for (int i = 0; i < numRows; i++)
+        {
+            inputRows[i] = &input[i * length];
+            expectedRows[i] = &expected[i * length];
+            actualRows[i] = &actual[i * length];
+        }
+
+        reference.filterRowsYvV(inputRows.data(), expectedRows.data(), numRows, length, coeffs, scratch.data());
+        kernels.filterRowsYvV(inputRows.data(), actualRows.data(), numRows, length, coeffs, scratch.data());
+
+        for (size_t i = 0; i < expected.size(); i++)
+            IMPPG_ASSERT(std::abs(expected[i] - actual[i]) <= 1.0e-4f * std::abs(expected[i]) + 1.0e-6f);
+
+        // The same data seen as `length` rows, each `numRows` elements long (i.e. columns are filtered)
+        expected = input;
+        actual = input;
+        reference.filterColumnsYvV(expected.data(), numRows * sizeof(float), numRows, length, coeffs);
+        kernels.filterColumnsYvV(actual.data(), numRows * sizeof(float), numRows, length, coeffs);
+
+        for (size_t i = 0; i < expected.size(); i++)
+            IMPPG_ASSERT(std::abs(expected[i] - actual[i]) <= 1.0e-4f * std::abs(expected[i]) + 1.0e-6f);
+
+        // Box filters, including ones wider than the data
+        const int radii[] = { 0, 3, 4, 60 };
+        const int numBoxes = sizeof(radii) / sizeof(radii[0]);
+        std::vector<float> boxScratch(std::max(2 * (length + 2 * 60) * MAX_SIMD_WIDTH, (2 * 60 + 2) * numRows));
+
+        reference.boxFilterRows(inputRows.data(), expectedRows.data(), numRows, length, radii, numBoxes, boxScratch.data());
+        kernels.boxFilterRows(inputRows.data(), actualRows.data(), numRows, length, radii, numBoxes, boxScratch.data());
+
+        for (size_t i = 0; i < expected.size(); i++)
+            IMPPG_ASSERT(std::abs(expected[i] - actual[i]) <= 1.0e-4f * std::abs(expected[i]) + 1.0e-6f);
+
+        expected = input;
+        actual = input;
+        reference.boxFilterColumns(expected.data(), numRows * sizeof(float), numRows, length, radii, numBoxes, boxScratch.data());
+        kernels.boxFilterColumns(actual.data(), numRows * sizeof(float), numRows, length, radii, numBoxes, boxScratch.data());
+
+        for (size_t i = 0; i < expected.size(); i++)
+            IMPPG_ASSERT(std::abs(expected[i] - actual[i]) <= 1.0e-4f * std::abs(expected[i]) + 1.0e-6f);
+    }
+
+    for (const ConvolutionEpilogue epilogue: { ConvolutionEpilogue::DIVIDE_INTO, ConvolutionEpilogue::MULTIPLY })
+    {
+        const int length = 37;
+        std::vector<float> expected(length), actual(length), operand(length);
+        for (int i = 0; i < length; i++)
+        {
+            expected[i] = actual[i] = static_cast<float>(i % 5) / 5.0f;
+            operand[i] = static_cast<float>(i % 7) / 7.0f;
+        }
+
+        reference.applyEpilogue(expected.data(), operand.data(), length, epilogue);
+        kernels.applyEpilogue(actual.data(), operand.data(), length, epilogue);
+
+        for (int i = 0; i < length; i++)
+            IMPPG_ASSERT(std::abs(expected[i] - actual[i]) <= 1.0e-4f * std::abs(expected[i]) + 1.0e-6f);
+    }
+}
+#endif
+
+static const ConvolutionKernels& SelectConvolutionKernels()
+{
+    const ConvolutionKernels* kernels = &GetScalarConvolutionKernels();
+
+#if IMPPG_X86_SIMD
+    switch (GetSimdLevel())
+    {
+    case SimdLevel::AVX512: kernels = &GetAVX512ConvolutionKernels(); break;
+    case SimdLevel::AVX2:   kernels = &GetAVX2ConvolutionKernels(); break;
+    case SimdLevel::SSE4:   kernels = &GetSSE4ConvolutionKernels(); break;
+    default: break;
+    }
+#endif
+
+#ifndef NDEBUG
+    VerifyConvolutionKernels(*kernels);
+#endif
+
+    return *kernels;
+}
+
+const ConvolutionKernels& GetConvolutionKernels()
+{
+    static const ConvolutionKernels& kernels = SelectConvolutionKernels();
+    return kernels;
+}
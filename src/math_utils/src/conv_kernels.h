@@ -0,0 +1,118 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Low-level convolution kernels header.
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "math_utils/convolution.h"
+#include "math_utils/cpu_features.h"
+
+/// Maximum number of floats in a vector register of any supported instruction set.
+constexpr int MAX_SIMD_WIDTH = 16;
+
+/// Range of kernel radii for which there are variants of `convolveRow` and `convolveColumns` specialized
+/// for a compile-time radius (with the kernel's taps kept in registers and the loops over them unrolled).
+constexpr int MIN_SPECIALIZED_KERNEL_RADIUS = 2;
+constexpr int MAX_SPECIALIZED_KERNEL_RADIUS = 16;
+
+using ConvolveRowFn = void (*)(const float input[], float output[], int length, const float halfKernel[], int kernelRadius);
+using ConvolveColumnsFn = void (*)(const float input[], std::ptrdiff_t stride, float output[], int length, const float halfKernel[], int kernelRadius);
+
+/// Set of low-level convolution kernels compiled for a single instruction set.
+struct ConvolutionKernels
+{
+    SimdLevel simdLevel;
+
+    /// Convolves `length` consecutive elements of a row with a symmetric kernel.
+    /** Elements from input[-(kernelRadius-1)] to input[length-1 + kernelRadius-1] must be readable.
+        `halfKernel` contains `kernelRadius` elements; element [0] is the kernel's middle. */
+    ConvolveRowFn convolveRow;
+
+    /// Convolves `length` consecutive elements of a row with a symmetric kernel applied vertically.
+    /** Computes `output[i] = sum(halfKernel[|j|] * input[i + j*stride])`; elements of rows from -(kernelRadius-1)
+        to kernelRadius-1 (with the given `stride` in elements) must be readable. */
+    ConvolveColumnsFn convolveColumns;
+
+    /// Performs forward and backward Young & van Vliet recursive filtering of `numRows` rows, each of `length` elements.
+    /** Vectorized implementations filter several rows at once, interleaved across the vector lanes.
+        `outputRows` may equal `inputRows`. `scratch` must contain at least `length * MAX_SIMD_WIDTH` elements. */
+    void (*filterRowsYvV)(
+        const float* const inputRows[], float* const outputRows[], int numRows, int length,
+        const YvVCoefficients& coeffs, float scratch[]);
+
+    /// Performs in-place forward and backward Young & van Vliet recursive filtering of `width` columns, each of `height` elements.
+    void (*filterColumnsYvV)(float data[], int bytesPerRow, int width, int height, const YvVCoefficients& coeffs);
+
+    /// Applies successively `numBoxes` box filters with the specified radii to `numRows` rows, each of `length` elements.
+    /** Border values are assumed to extend beyond the rows. Vectorized implementations filter several rows at once,
+        interleaved across the vector lanes. `outputRows` may equal `inputRows`. `scratch` must contain at least
+        `2 * (length + 2 * max(radii)) * MAX_SIMD_WIDTH` elements. */
+    void (*boxFilterRows)(
+        const float* const inputRows[], float* const outputRows[], int numRows, int length,
+        const int radii[], int numBoxes, float scratch[]);
+
+    /// Applies in place successively `numBoxes` box filters with the specified radii to `width` columns, each of `height` elements.
+    /** Border values are assumed to extend beyond the columns. `scratch` must contain at least
+        `(2 * max(radii) + 2) * width` elements. */
+    void (*boxFilterColumns)(float data[], int bytesPerRow, int width, int height, const int radii[], int numBoxes, float scratch[]);
+
+    /// Applies `epilogue` (other than NONE) to `length` elements of `data`, using the corresponding elements of `operand`.
+    void (*applyEpilogue)(float data[], const float operand[], int length, ConvolutionEpilogue epilogue);
+
+    /// Variants of `convolveRow` specialized for a compile-time kernel radius; element [r] is used for radius r.
+    /** Null elements (and radii beyond the table) are handled by `convolveRow`. */
+    ConvolveRowFn convolveRowFixed[MAX_SPECIALIZED_KERNEL_RADIUS + 1];
+
+    /// Variants of `convolveColumns` specialized for a compile-time kernel radius; element [r] is used for radius r.
+    /** Null elements (and radii beyond the table) are handled by `convolveColumns`. */
+    ConvolveColumnsFn convolveColumnsFixed[MAX_SPECIALIZED_KERNEL_RADIUS + 1];
+
+    /// Returns the best `convolveRow` variant for the specified kernel radius.
+    ConvolveRowFn GetConvolveRow(int kernelRadius) const
+    {
+        return (kernelRadius <= MAX_SPECIALIZED_KERNEL_RADIUS && convolveRowFixed[kernelRadius])
+            ? convolveRowFixed[kernelRadius]
+            : convolveRow;
+    }
+
+    /// Returns the best `convolveColumns` variant for the specified kernel radius.
+    ConvolveColumnsFn GetConvolveColumns(int kernelRadius) const
+    {
+        return (kernelRadius <= MAX_SPECIALIZED_KERNEL_RADIUS && convolveColumnsFixed[kernelRadius])
+            ? convolveColumnsFixed[kernelRadius]
+            : convolveColumns;
+    }
+};
+
+/// Returns kernels for the highest instruction set supported by the CPU (see `GetSimdLevel`).
+const ConvolutionKernels& GetConvolutionKernels();
+
+/// Returns the non-vectorized reference kernels.
+const ConvolutionKernels& GetScalarConvolutionKernels();
+
+#if IMPPG_X86_SIMD
+const ConvolutionKernels& GetSSE4ConvolutionKernels();
+const ConvolutionKernels& GetAVX2ConvolutionKernels();
+const ConvolutionKernels& GetAVX512ConvolutionKernels();
+#endif
@@ -0,0 +1,565 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Vectorized convolution kernels templates.
+
+    Included by the per-instruction-set translation units (conv_kernels_<ISA>.cpp) after simd.h;
+    `V` is one of the wrappers from simd.h.
+
+    NOTE: Every function here must be a template depending on `V`. A non-template inline function
+    (or an inline function from the standard library) would be compiled separately in each
+    translation unit with different instruction set flags, and the linker could then pick
+    e.g. the AVX-512 copy for use on a CPU without AVX-512.
+*/
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+/// Calls `func(std::integral_constant<int, I>{})` for I = 0, ..., sizeof...(I)-1.
+/** Being instantiated with a lambda (a type local to a translation unit), it does not violate the rule above. */
+template<typename Func, int... I>
+void UnrolledForImpl(Func&& func, std::integer_sequence<int, I...>)
+{
+    (func(std::integral_constant<int, I>{}), ...);
+}
+
+/// Calls `func(std::integral_constant<int, I>{})` for I = 0, ..., N-1; i.e. a fully unrolled loop.
+template<int N, typename Func>
+void UnrolledFor(Func&& func)
+{
+    UnrolledForImpl(func, std::make_integer_sequence<int, N>{});
+}
+
+/// Computes `output[i] = sum(halfKernel[|j|] * input[i+j])` for 0 <= i < length, -(kernelRadius-1) <= j <= kernelRadius-1.
+/** If `R` > 0, it is used instead of `kernelRadius`. */
+template<typename V, int R = 0>
+void ConvolveRowSymmetric(const float input[], float output[], int length, const float halfKernel[], int kernelRadius)
+{
+    using Reg = typename V::Reg;
+    constexpr int W = V::WIDTH;
+
+    if constexpr (R > 0)
+        kernelRadius = R;
+
+    // With a compile-time radius, the taps are broadcast once and kept in registers
+    Reg fixedTaps[R > 0 ? R : 1];
+    if constexpr (R > 0)
+        for (int j = 0; j < R; j++)
+            fixedTaps[j] = V::Set1(halfKernel[j]);
+
+    const auto tap = [&](int j)
+    {
+        if constexpr (R > 0)
+            return fixedTaps[j];
+        else
+            return V::Set1(halfKernel[j]);
+    };
+
+    int i = 0;
+
+    // Process 4 registers at a time to have independent chains of multiply-adds in flight
+    for (; i + 4*W <= length; i += 4*W)
+    {
+        Reg sum0 = V::Mul(V::Load(input + i),       tap(0));
+        Reg sum1 = V::Mul(V::Load(input + i + W),   tap(0));
+        Reg sum2 = V::Mul(V::Load(input + i + 2*W), tap(0));
+        Reg sum3 = V::Mul(V::Load(input + i + 3*W), tap(0));
+
+        for (int j = 1; j < kernelRadius; j++)
+        {
+            const Reg k = tap(j);
+            sum0 = V::MulAdd(V::Add(V::Load(input + i - j),       V::Load(input + i + j)),       k, sum0);
+            sum1 = V::MulAdd(V::Add(V::Load(input + i + W - j),   V::Load(input + i + W + j)),   k, sum1);
+            sum2 = V::MulAdd(V::Add(V::Load(input + i + 2*W - j), V::Load(input + i + 2*W + j)), k, sum2);
+            sum3 = V::MulAdd(V::Add(V::Load(input + i + 3*W - j), V::Load(input + i + 3*W + j)), k, sum3);
+        }
+
+        V::Store(output + i,       sum0);
+        V::Store(output + i + W,   sum1);
+        V::Store(output + i + 2*W, sum2);
+        V::Store(output + i + 3*W, sum3);
+    }
+
+    for (; i + W <= length; i += W)
+    {
+        Reg sum = V::Mul(V::Load(input + i), tap(0));
+        for (int j = 1; j < kernelRadius; j++)
+            sum = V::MulAdd(V::Add(V::Load(input + i - j), V::Load(input + i + j)), tap(j), sum);
+
+        V::Store(output + i, sum);
+    }
+
+    for (; i < length; i++)
+    {
+        float sum = input[i] * halfKernel[0];
+        for (int j = 1; j < kernelRadius; j++)
+            sum += (input[i - j] + input[i + j]) * halfKernel[j];
+
+        output[i] = sum;
+    }
+}
+
+/// Computes `output[i] = sum(halfKernel[|j|] * input[i + j*stride])` for 0 <= i < length, -(kernelRadius-1) <= j <= kernelRadius-1.
+/** If `R` > 0, it is used instead of `kernelRadius`. */
+template<typename V, int R = 0>
+void ConvolveColumnsSymmetric(const float input[], std::ptrdiff_t stride, float output[], int length, const float halfKernel[], int kernelRadius)
+{
+    using Reg = typename V::Reg;
+    constexpr int W = V::WIDTH;
+
+    if constexpr (R > 0)
+        kernelRadius = R;
+
+    // With a compile-time radius, the taps are broadcast once and kept in registers
+    Reg fixedTaps[R > 0 ? R : 1];
+    if constexpr (R > 0)
+        for (int j = 0; j < R; j++)
+            fixedTaps[j] = V::Set1(halfKernel[j]);
+
+    const auto tap = [&](int j)
+    {
+        if constexpr (R > 0)
+            return fixedTaps[j];
+        else
+            return V::Set1(halfKernel[j]);
+    };
+
+    int i = 0;
+
+    for (; i + 4*W <= length; i += 4*W)
+    {
+        Reg sum0 = V::Mul(V::Load(input + i),       tap(0));
+        Reg sum1 = V::Mul(V::Load(input + i + W),   tap(0));
+        Reg sum2 = V::Mul(V::Load(input + i + 2*W), tap(0));
+        Reg sum3 = V::Mul(V::Load(input + i + 3*W), tap(0));
+
+        // Step the row pointers instead of computing `i +/- j*stride`, so that unrolled code does not need
+        // a separate register for each offset
+        const float* above = input + i;
+        const float* below = input + i;
+        for (int j = 1; j < kernelRadius; j++)
+        {
+            const Reg k = tap(j);
+            above -= stride;
+            below += stride;
+            sum0 = V::MulAdd(V::Add(V::Load(above),       V::Load(below)),       k, sum0);
+            sum1 = V::MulAdd(V::Add(V::Load(above + W),   V::Load(below + W)),   k, sum1);
+            sum2 = V::MulAdd(V::Add(V::Load(above + 2*W), V::Load(below + 2*W)), k, sum2);
+            sum3 = V::MulAdd(V::Add(V::Load(above + 3*W), V::Load(below + 3*W)), k, sum3);
+        }
+
+        V::Store(output + i,       sum0);
+        V::Store(output + i + W,   sum1);
+        V::Store(output + i + 2*W, sum2);
+        V::Store(output + i + 3*W, sum3);
+    }
+
+    for (; i + W <= length; i += W)
+    {
+        Reg sum = V::Mul(V::Load(input + i), tap(0));
+        const float* above = input + i;
+        const float* below = input + i;
+        for (int j = 1; j < kernelRadius; j++)
+        {
+            above -= stride;
+            below += stride;
+            sum = V::MulAdd(V::Add(V::Load(above), V::Load(below)), tap(j), sum);
+        }
+
+        V::Store(output + i, sum);
+    }
+
+    for (; i < length; i++)
+    {
+        float sum = input[i] * halfKernel[0];
+        for (int j = 1; j < kernelRadius; j++)
+            sum += (input[i - j * stride] + input[i + j * stride]) * halfKernel[j];
+
+        output[i] = sum;
+    }
+}
+
+/// Forward and backward Young & van Vliet filtering of groups of `V::WIDTH` rows interleaved across the vector lanes.
+/** The recurrence is serial along a row, but independent between rows; with each lane holding a different row,
+    a single chain of vector operations filters `V::WIDTH` rows at once. */
+template<typename V>
+void FilterRowsYvV(
+    const float* const inputRows[], float* const outputRows[], int numRows, int length,
+    const YvVCoefficients& coeffs, float scratch[])
+{
+    using Reg = typename V::Reg;
+    constexpr int W = V::WIDTH;
+
+    const Reg B = V::Set1(coeffs.B);
+    const Reg c1 = V::Set1(coeffs.b1 * coeffs.b0inv);
+    const Reg c2 = V::Set1(coeffs.b2 * coeffs.b0inv);
+    const Reg c3 = V::Set1(coeffs.b3 * coeffs.b0inv);
+
+    // `prev1` is added last to keep only one multiply-add in the loop-carried dependency chain
+    const auto filterStep = [&](Reg input, Reg prev1, Reg prev2, Reg prev3)
+    {
+        return V::MulAdd(c1, prev1, V::MulAdd(c2, prev2, V::MulAdd(B, input, V::Mul(c3, prev3))));
+    };
+
+    for (int row0 = 0; row0 < numRows; row0 += W)
+    {
+        const int groupSize = (numRows - row0 < W) ? numRows - row0 : W;
+
+        // Interleave the rows; if there are fewer than W left, the unused lanes repeat the last row
+        for (int k = 0; k < W; k++)
+        {
+            const float* row = inputRows[row0 + (k < groupSize ? k : groupSize - 1)];
+            for (int i = 0; i < length; i++)
+                scratch[i * W + k] = row[i];
+        }
+
+        // Forward filtering; assume that border values extend beyond the rows
+        Reg prev1 = V::Load(scratch);
+        Reg prev2 = prev1;
+        Reg prev3 = prev1;
+        for (int i = 0; i < length; i++)
+        {
+            const Reg next = filterStep(V::Load(scratch + i * W), prev1, prev2, prev3);
+            prev3 = prev2;
+            prev2 = prev1;
+            prev1 = next;
+            V::Store(scratch + i * W, next);
+        }
+
+        // Backward filtering
+        prev1 = prev2 = prev3 = V::Load(scratch + (length - 1) * W);
+        for (int i = length - 1; i >= 0; i--)
+        {
+            const Reg next = filterStep(V::Load(scratch + i * W), prev1, prev2, prev3);
+            prev3 = prev2;
+            prev2 = prev1;
+            prev1 = next;
+            V::Store(scratch + i * W, next);
+        }
+
+        for (int k = 0; k < groupSize; k++)
+        {
+            float* row = outputRows[row0 + k];
+            for (int i = 0; i < length; i++)
+                row[i] = scratch[i * W + k];
+        }
+    }
+}
+
+/// In-place forward and backward Young & van Vliet filtering of columns, vectorized across the columns.
+template<typename V>
+void FilterColumnsYvV(float data[], int bytesPerRow, int width, int height, const YvVCoefficients& coeffs)
+{
+    using Reg = typename V::Reg;
+    constexpr int W = V::WIDTH;
+
+    const Reg B = V::Set1(coeffs.B);
+    const Reg c1 = V::Set1(coeffs.b1 * coeffs.b0inv);
+    const Reg c2 = V::Set1(coeffs.b2 * coeffs.b0inv);
+    const Reg c3 = V::Set1(coeffs.b3 * coeffs.b0inv);
+
+    const auto row = [&](int y) { return OffsetBytes(data, y * static_cast<std::ptrdiff_t>(bytesPerRow)); };
+
+    // Recurrence state of W columns
+    struct State { Reg prev1, prev2, prev3; };
+
+    const auto init = [&](const float* ptr) { const Reg v = V::Load(ptr); return State{ v, v, v }; };
+
+    const auto step = [&](State& s, float* ptr)
+    {
+        const Reg next = V::MulAdd(c1, s.prev1, V::MulAdd(c2, s.prev2, V::MulAdd(B, V::Load(ptr), V::Mul(c3, s.prev3))));
+        s.prev3 = s.prev2;
+        s.prev2 = s.prev1;
+        s.prev1 = next;
+        V::Store(ptr, next);
+    };
+
+    int x = 0;
+
+    // Filter 4 registers' worth of columns at a time to have independent recurrences in flight;
+    // border values are assumed to extend beyond the columns
+    for (; x + 4*W <= width; x += 4*W)
+    {
+        State s0 = init(row(0) + x), s1 = init(row(0) + x + W), s2 = init(row(0) + x + 2*W), s3 = init(row(0) + x + 3*W);
+        for (int y = 0; y < height; y++)
+        {
+            float* ptr = row(y) + x;
+            step(s0, ptr); step(s1, ptr + W); step(s2, ptr + 2*W); step(s3, ptr + 3*W);
+        }
+
+        s0 = init(row(height - 1) + x); s1 = init(row(height - 1) + x + W); s2 = init(row(height - 1) + x + 2*W); s3 = init(row(height - 1) + x + 3*W);
+        for (int y = height - 1; y >= 0; y--)
+        {
+            float* ptr = row(y) + x;
+            step(s0, ptr); step(s1, ptr + W); step(s2, ptr + 2*W); step(s3, ptr + 3*W);
+        }
+    }
+
+    for (; x + W <= width; x += W)
+    {
+        State s = init(row(0) + x);
+        for (int y = 0; y < height; y++)
+            step(s, row(y) + x);
+
+        s = init(row(height - 1) + x);
+        for (int y = height - 1; y >= 0; y--)
+            step(s, row(y) + x);
+    }
+
+    for (; x < width; x++)
+    {
+        float prev1, prev2, prev3;
+
+        prev1 = prev2 = prev3 = row(0)[x];
+        for (int y = 0; y < height; y++)
+        {
+            const float next = coeffs.B * row(y)[x] + (coeffs.b1*prev1 + coeffs.b2*prev2 + coeffs.b3*prev3) * coeffs.b0inv;
+            prev3 = prev2; prev2 = prev1; prev1 = next;
+            row(y)[x] = next;
+        }
+
+        prev1 = prev2 = prev3 = row(height - 1)[x];
+        for (int y = height - 1; y >= 0; y--)
+        {
+            const float next = coeffs.B * row(y)[x] + (coeffs.b1*prev1 + coeffs.b2*prev2 + coeffs.b3*prev3) * coeffs.b0inv;
+            prev3 = prev2; prev2 = prev1; prev1 = next;
+            row(y)[x] = next;
+        }
+    }
+}
+
+/// Box filtering of groups of `V::WIDTH` rows interleaved across the vector lanes, using running sums.
+template<typename V>
+void BoxFilterRows(
+    const float* const inputRows[], float* const outputRows[], int numRows, int length,
+    const int radii[], int numBoxes, float scratch[])
+{
+    using Reg = typename V::Reg;
+    constexpr int W = V::WIDTH;
+
+    int maxRadius = 0;
+    for (int i = 0; i < numBoxes; i++)
+        maxRadius = (radii[i] > maxRadius) ? radii[i] : maxRadius;
+
+    // Two interleaved buffers, each with room for `maxRadius` replicated values before and after the rows' elements;
+    // `at(buf, i)` points to the i-th element (of all W rows), -maxRadius <= i < length + maxRadius
+    const int paddedLength = length + 2 * maxRadius;
+    float* src = scratch;
+    float* dest = scratch + paddedLength * W;
+    const auto at = [&](float* buf, int i) { return buf + (i + maxRadius) * W; };
+
+    for (int row0 = 0; row0 < numRows; row0 += W)
+    {
+        const int groupSize = (numRows - row0 < W) ? numRows - row0 : W;
+
+        // Interleave the rows; if there are fewer than W left, the unused lanes repeat the last row
+        for (int k = 0; k < W; k++)
+        {
+            const float* row = inputRows[row0 + (k < groupSize ? k : groupSize - 1)];
+            for (int i = 0; i < length; i++)
+                at(src, i)[k] = row[i];
+        }
+
+        for (int box = 0; box < numBoxes; box++)
+        {
+            const int radius = radii[box];
+
+            const Reg first = V::Load(at(src, 0));
+            const Reg last = V::Load(at(src, length - 1));
+            for (int i = 1; i <= radius; i++)
+            {
+                V::Store(at(src, -i), first);
+                V::Store(at(src, length - 1 + i), last);
+            }
+
+            Reg sum = V::Zero();
+            for (int i = -radius; i <= radius; i++)
+                sum = V::Add(sum, V::Load(at(src, i)));
+
+            const Reg norm = V::Set1(1.0f / (2 * radius + 1));
+            V::Store(at(dest, 0), V::Mul(sum, norm));
+            for (int i = 1; i < length; i++)
+            {
+                sum = V::Add(sum, V::Sub(V::Load(at(src, i + radius)), V::Load(at(src, i - radius - 1))));
+                V::Store(at(dest, i), V::Mul(sum, norm));
+            }
+
+            float* temp = src; src = dest; dest = temp;
+        }
+
+        for (int k = 0; k < groupSize; k++)
+        {
+            float* row = outputRows[row0 + k];
+            for (int i = 0; i < length; i++)
+                row[i] = at(src, i)[k];
+        }
+    }
+}
+
+/// In-place box filtering of columns using running sums, vectorized across the columns.
+template<typename V>
+void BoxFilterColumns(float data[], int bytesPerRow, int width, int height, const int radii[], int numBoxes, float scratch[])
+{
+    using Reg = typename V::Reg;
+    constexpr int W = V::WIDTH;
+
+    const auto row = [&](int y)
+    {
+        y = (y < 0) ? 0 : (y >= height ? height - 1 : y); // border values extend beyond the columns
+        return OffsetBytes(data, y * static_cast<std::ptrdiff_t>(bytesPerRow));
+    };
+
+    // Running sums of all columns
+    float* sums = scratch;
+
+    // Applies `func(x, w)` to all columns in groups of w = W, then w = 1
+    const auto forColumns = [&](auto func)
+    {
+        int x = 0;
+        for (; x + W <= width; x += W)
+            func(x, std::integral_constant<int, W>{});
+        for (; x < width; x++)
+            func(x, std::integral_constant<int, 1>{});
+    };
+
+    for (int box = 0; box < numBoxes; box++)
+    {
+        const int radius = radii[box];
+        const int windowSize = 2 * radius + 1;
+
+        // Original (unfiltered) values of the rows within the current window; row `i` is stored in slot `i mod windowSize`,
+        // as the rows above the current one have already been overwritten
+        float* ring = scratch + width;
+        const auto slot = [&](int i) { return ring + ((i % windowSize + windowSize) % windowSize) * width; };
+
+        forColumns([&](int x, auto w)
+        {
+            if constexpr (decltype(w)::value == W)
+            {
+                Reg sum = V::Zero();
+                for (int i = -radius; i <= radius; i++)
+                {
+                    const Reg value = V::Load(row(i) + x);
+                    V::Store(slot(i) + x, value);
+                    sum = V::Add(sum, value);
+                }
+                V::Store(sums + x, sum);
+            }
+            else
+            {
+                float sum = 0.0f;
+                for (int i = -radius; i <= radius; i++)
+                {
+                    slot(i)[x] = row(i)[x];
+                    sum += slot(i)[x];
+                }
+                sums[x] = sum;
+            }
+        });
+
+        const float normScalar = 1.0f / windowSize;
+        const Reg norm = V::Set1(normScalar);
+
+        for (int y = 0; y < height; y++)
+        {
+            // The window moves from [y-1-radius, y-1+radius] to [y-radius, y+radius]; the incoming row
+            // has not been overwritten yet, the outgoing one is taken from (and replaced in) the ring
+            float* incoming = row(y + radius);
+            float* ringSlot = slot(y + radius);
+            float* dest = row(y);
+
+            forColumns([&](int x, auto w)
+            {
+                if constexpr (decltype(w)::value == W)
+                {
+                    Reg sum = V::Load(sums + x);
+                    if (y > 0)
+                    {
+                        const Reg value = V::Load(incoming + x);
+                        sum = V::Add(sum, V::Sub(value, V::Load(ringSlot + x)));
+                        V::Store(ringSlot + x, value);
+                        V::Store(sums + x, sum);
+                    }
+                    V::Store(dest + x, V::Mul(sum, norm));
+                }
+                else
+                {
+                    if (y > 0)
+                    {
+                        const float value = incoming[x];
+                        sums[x] += value - ringSlot[x];
+                        ringSlot[x] = value;
+                    }
+                    dest[x] = sums[x] * normScalar;
+                }
+            });
+        }
+    }
+}
+
+/// Applies an element-wise convolution epilogue.
+template<typename V>
+void ApplyEpilogue(float data[], const float operand[], int length, ConvolutionEpilogue epilogue)
+{
+    constexpr int W = V::WIDTH;
+
+    int i = 0;
+    if (epilogue == ConvolutionEpilogue::DIVIDE_INTO)
+    {
+        const typename V::Reg epsilon = V::Set1(CONVOLUTION_DIVISION_EPSILON);
+        for (; i + W <= length; i += W)
+            V::Store(data + i, V::Div(V::Load(operand + i), V::Add(V::Load(data + i), epsilon)));
+        for (; i < length; i++)
+            data[i] = operand[i] / (data[i] + CONVOLUTION_DIVISION_EPSILON);
+    }
+    else if (epilogue == ConvolutionEpilogue::MULTIPLY)
+    {
+        for (; i + W <= length; i += W)
+            V::Store(data + i, V::Mul(V::Load(operand + i), V::Load(data + i)));
+        for (; i < length; i++)
+            data[i] *= operand[i];
+    }
+}
+
+/// Fills a kernel table with the instantiations for `V`.
+template<typename V>
+ConvolutionKernels MakeConvolutionKernels(SimdLevel simdLevel)
+{
+    ConvolutionKernels kernels{};
+    kernels.simdLevel = simdLevel;
+    kernels.convolveRow = &ConvolveRowSymmetric<V>;
+    kernels.convolveColumns = &ConvolveColumnsSymmetric<V>;
+    kernels.filterRowsYvV = &FilterRowsYvV<V>;
+    kernels.filterColumnsYvV = &FilterColumnsYvV<V>;
+    kernels.boxFilterRows = &BoxFilterRows<V>;
+    kernels.boxFilterColumns = &BoxFilterColumns<V>;
+    kernels.applyEpilogue = &ApplyEpilogue<V>;
+
+    UnrolledFor<MAX_SPECIALIZED_KERNEL_RADIUS - MIN_SPECIALIZED_KERNEL_RADIUS + 1>([&](auto i)
+    {
+        constexpr int R = MIN_SPECIALIZED_KERNEL_RADIUS + decltype(i)::value;
+        kernels.convolveRowFixed[R] = &ConvolveRowSymmetric<V, R>;
+        kernels.convolveColumnsFixed[R] = &ConvolveColumnsSymmetric<V, R>;
+    });
+
+    return kernels;
+}
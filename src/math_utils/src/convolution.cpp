@@ -23,79 +23,83 @@ File description:
 
 #include "math_utils/convolution.h"
 #include "math_utils/gauss.h"
+#include "conv_kernels.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
 #include <cstring>
-#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "../../imppg_assert.h"
 
-/// Performs a single step of 1D convolution using the middle kernel value 'kernelVal'
-inline void Convolve1Dstep_OfsZero(const float input[], float output[], int len, float kernelVal)
+#if defined(_OPENMP)
+#include <omp.h>
+#else
+static int omp_get_thread_num() { return 0; }
+static int omp_get_max_threads() { return 1; }
+#endif
+
+/// Element [i] is used for images of size class i; 0 if not calibrated yet.
+static std::array<std::atomic<int>, NUM_CONVOLUTION_SIZE_CLASSES> s_YoungVanVlietMinKernelRadius{};
+
+/// Serializes lazy calibrations, so that they do not disturb each other's timings.
+static std::mutex s_CalibrationMutex;
+
+int GetConvolutionSizeClass(int width, int height)
 {
-    for (int i = 0; i < len; i++)
+    const auto numPixels = static_cast<std::int64_t>(width) * height;
+    for (int i = 0; i < NUM_CONVOLUTION_SIZE_CLASSES - 1; i++)
     {
-        float influence = input[i] * kernelVal;
-        output[i] += influence;
+        // The boundary between classes is the geometric mean of their test images' numbers of pixels
+        if (numPixels <= static_cast<std::int64_t>(CONVOLUTION_CALIBRATION_IMAGE_SIZES[i]) * CONVOLUTION_CALIBRATION_IMAGE_SIZES[i + 1])
+            return i;
     }
+    return NUM_CONVOLUTION_SIZE_CLASSES - 1;
 }
 
-/// Performs a single step of 1D convolution using the kernel value 'kernelVal', offset by 'kernelOfs' elements from kernel's middle
-inline void Convolve1Dstep_OfsNonZero(const float input[], float output[], int len, float kernelVal, int kernelOfs)
+int GetYoungVanVlietMinKernelRadius(int sizeClass)
 {
-    for (int i = 0; i < len; i++)
-    {
-        float influence = input[i] * kernelVal;
-        output[i + kernelOfs] += influence;
-        output[i - kernelOfs] += influence;
-    }
+    IMPPG_ASSERT(sizeClass >= 0 && sizeClass < NUM_CONVOLUTION_SIZE_CLASSES);
+    return s_YoungVanVlietMinKernelRadius[sizeClass];
 }
 
+void SetYoungVanVlietMinKernelRadius(int sizeClass, int radius)
+{
+    IMPPG_ASSERT(sizeClass >= 0 && sizeClass < NUM_CONVOLUTION_SIZE_CLASSES);
+    IMPPG_ASSERT(radius == 0 || radius >= 2);
+    s_YoungVanVlietMinKernelRadius[sizeClass] = radius;
+}
 
-/// Performs a Young & van Vliet approximated recursive Gaussian filtering of values in one direction
-inline void YvVFilterValues(
-    const float input[], ///< Input array
-    float output[], ///< Output array (may equal 'input')
-    int length, ///< Number of elements in 'input', 'output'
-    int direction, ///< 1: filter forward, -1: filter backward; if -1, processing starts at the last element
-    // YvV coefficients
-    float b0inv, float b1, float b2, float b3, float B
-)
+/// Returns the minimum kernel radius for which ConvolutionMethod::AUTO selects YOUNG_VAN_VLIET,
+/// calibrating it first if needed.
+static int GetCalibratedYoungVanVlietMinKernelRadius(int width, int height)
 {
-    int startIdx; // Starting index to process (inclusive)
-    int endIdx; // End index to process (exclusive)
-    if (direction == 1)
-    {
-        startIdx = 0;
-        endIdx = length;
-    }
-    else if (direction == -1)
-    {
-        startIdx = length - 1;
-        endIdx = -1;
-    }
-    else
+    const int sizeClass = GetConvolutionSizeClass(width, height);
+    int radius = s_YoungVanVlietMinKernelRadius[sizeClass];
+    if (radius == 0)
     {
-        IMPPG_ABORT_MSG("direction must be 1 or -1");
+        const std::lock_guard<std::mutex> lock(s_CalibrationMutex);
+        radius = s_YoungVanVlietMinKernelRadius[sizeClass];
+        if (radius == 0)
+        {
+            const int size = CONVOLUTION_CALIBRATION_IMAGE_SIZES[sizeClass];
+            radius = CalibrateYoungVanVlietMinKernelRadius(size, size);
+            s_YoungVanVlietMinKernelRadius[sizeClass] = radius;
+        }
     }
+    return radius;
+}
 
-    float prev1, prev2, prev3; // Previously calculated values
-
-    // Assume that border values extend beyond the array
-    prev1 = prev2 = prev3 = input[startIdx];
-
-    for (int i = startIdx; i != endIdx; i += direction)
-    {
-        float next = B * input[i] + (b1*prev1 + b2*prev2 + b3*prev3) * b0inv;
-        prev3 = prev2;
-        prev2 = prev1;
-        prev1 = next;
-
-        output[i] = next;
-    }
+int GetConvolutionNumThreads()
+{
+    return omp_get_max_threads();
 }
 
-inline void CalculateYvVCoefficients(float sigma, float& b0inv, float& b1, float& b2, float& b3, float& B)
+static YvVCoefficients CalculateYvVCoefficients(float sigma)
 {
     float q;
     if (sigma >= 0.5f && sigma <= 2.5f)
@@ -103,190 +107,484 @@ inline void CalculateYvVCoefficients(float sigma, float& b0inv, float& b1, float
     else
         q = 0.98711f * sigma - 0.9633f;
 
+    YvVCoefficients c;
     float b0 = 1.57825f + 2.44413f * q + 1.4281f*q*q + 0.422205f*q*q*q;
-    b1 = 2.44413f*q + 2.85619f*q*q + 1.26661f*q*q*q;
-    b2 = -1.4281f*q*q - 1.26661f*q*q*q;
-    b3 = 0.422205f*q*q*q;
-    B = 1.0f - ((b1 + b2 + b3) / b0);
-    b0inv = 1.0f/b0;
+    c.b1 = 2.44413f*q + 2.85619f*q*q + 1.26661f*q*q*q;
+    c.b2 = -1.4281f*q*q - 1.26661f*q*q*q;
+    c.b3 = 0.422205f*q*q*q;
+    c.B = 1.0f - ((c.b1 + c.b2 + c.b3) / b0);
+    c.b0inv = 1.0f/b0;
+    return c;
 }
 
-void ConvolveGaussianRecursiveTranspose(
-    c_PaddedArrayPtr<const float> input,
-    c_PaddedArrayPtr<float> output,
-    float sigma,
-    float tempBuf1[],
-    float tempBuf2[]
-)
+/// Element-wise operation to apply to the convolution results, with its operand.
+struct Epilogue
 {
-    int width = input.width(), height = input.height();
-    IMPPG_ASSERT(sigma >= 0.5f);
+    ConvolutionEpilogue type;
+    c_PaddedArrayPtr<const float> operand;
+};
 
-    float b0inv, b1, b2, b3, B;
-    CalculateYvVCoefficients(sigma, b0inv, b1, b2, b3, B);
+static const Epilogue NO_EPILOGUE{ ConvolutionEpilogue::NONE, c_PaddedArrayPtr<const float>(nullptr, 0, 0) };
 
-    float* convRows = tempBuf1;
+/// Applies the epilogue to `length` elements of the specified output row, starting at `x0`.
+static void ApplyEpilogue(const ConvolutionKernels& kernels, const Epilogue& epilogue, c_PaddedArrayPtr<float>& output, int x0, int y, int length)
+{
+    if (epilogue.type != ConvolutionEpilogue::NONE)
+        kernels.applyEpilogue(output.row(y) + x0, epilogue.operand.row_const(y) + x0, length, epilogue.type);
+}
 
-    // Convolve rows
-    #pragma omp parallel for
-    for (int y = 0; y < height; y++)
+/// Scratch buffers of OpenMP threads; element [i] is used by the thread no. i.
+using ThreadBuffers = std::vector<std::vector<float>>;
+
+/// Makes sure there is a buffer for every thread; must be called outside of a parallel region.
+static void ReserveThreadBuffers(ThreadBuffers& buffers)
+{
+    if (buffers.size() < static_cast<std::size_t>(omp_get_max_threads()))
+        buffers.resize(omp_get_max_threads());
+}
+
+/// Returns the calling thread's scratch buffer, enlarged to at least 'size' elements if needed.
+static float* GetThreadBuffer(ThreadBuffers& buffers, std::size_t size)
+{
+    std::vector<float>& buffer = buffers[omp_get_thread_num()];
+    if (buffer.size() < size)
+        buffer.resize(size);
+
+    return buffer.data();
+}
+
+/// Passes rows of an array to a row-processing kernel; rows are processed in parallel in batches.
+template<typename InputRowFn, typename OutputRowFn, typename KernelFn>
+static void ProcessRowBatches(
+    int numRows,
+    ThreadBuffers& buffers,
+    std::size_t scratchSize, ///< Number of elements of the per-thread scratch buffer passed to 'kernel'
+    InputRowFn inputRow,  ///< Returns pointer to the specified row of input
+    OutputRowFn outputRow, ///< Returns pointer to the specified row of output
+    KernelFn kernel ///< Called with: input rows, output rows, number of rows, scratch buffer
+)
+{
+    // Rows passed to a single kernel call; a multiple of every vector width
+    constexpr int BATCH_SIZE = MAX_SIMD_WIDTH;
+    const int numBatches = (numRows + BATCH_SIZE - 1) / BATCH_SIZE;
+
+    ReserveThreadBuffers(buffers);
+
+    #pragma omp parallel
     {
-        // Perform forward filtering
-        YvVFilterValues(input.row_const(y), &convRows[y*width], width, 1, b0inv, b1, b2, b3, B);
+        float* scratch = GetThreadBuffer(buffers, scratchSize);
+
+        #pragma omp for
+        for (int batch = 0; batch < numBatches; batch++)
+        {
+            const int row0 = batch * BATCH_SIZE;
+            const int batchSize = std::min(BATCH_SIZE, numRows - row0);
+
+            const float* inputRows[BATCH_SIZE];
+            float* outputRows[BATCH_SIZE];
+            for (int i = 0; i < batchSize; i++)
+            {
+                inputRows[i] = inputRow(row0 + i);
+                outputRows[i] = outputRow(row0 + i);
+            }
 
-        // Perform backward filtering
-        YvVFilterValues(&convRows[y*width], &convRows[y*width], width, -1, b0inv, b1, b2, b3, B);
+            kernel(inputRows, outputRows, batchSize, scratch);
+        }
     }
+}
+
+static void ConvolveGaussianRecursive(
+    c_PaddedArrayPtr<const float> input,
+    c_PaddedArrayPtr<float> output,
+    const YvVCoefficients& coeffs,
+    ThreadBuffers& buffers,
+    const Epilogue& epilogue = NO_EPILOGUE
+)
+{
+    const int width = input.width(), height = input.height();
+    const ConvolutionKernels& kernels = GetConvolutionKernels();
+
+    // Convolve rows (forward and backward filtering)
+    ProcessRowBatches(height, buffers, width * MAX_SIMD_WIDTH,
+        [&](int y) { return input.row_const(y); },
+        [&](int y) { return output.row(y); },
+        [&](const float* const inputRows[], float* const outputRows[], int numRows, float scratch[])
+        {
+            kernels.filterRowsYvV(inputRows, outputRows, numRows, width, coeffs, scratch);
+        });
 
-    float* convRowsT = tempBuf2;
-    Transpose<float>(convRows, convRowsT, width, height, width*sizeof(float), height*sizeof(float), TRANSPOSITION_BLOCK_SIZE);
+    // Convolve columns in place; each thread filters a strip of columns, walking the rows in order
+    constexpr int STRIP_WIDTH = 64;
+    const int numStrips = (width + STRIP_WIDTH - 1) / STRIP_WIDTH;
 
-    // Convolve columns (now: rows, since we are using 'convRowsT' as source)
     #pragma omp parallel for
-    for (int y = 0; y < width; y++)
+    for (int strip = 0; strip < numStrips; strip++)
     {
-        // Perform forward filtering
-        YvVFilterValues(&convRowsT[y*height], output.row(y), height, 1, b0inv, b1, b2, b3, B);
-        // Perform backward filtering
-        YvVFilterValues(output.row(y), output.row(y), height, -1, b0inv, b1, b2, b3, B);
+        const int x0 = strip * STRIP_WIDTH;
+        const int stripWidth = std::min(STRIP_WIDTH, width - x0);
+        kernels.filterColumnsYvV(output.row(0) + x0, output.GetBytesPerRow(), stripWidth, height, coeffs);
+        for (int y = 0; y < height; y++)
+            ApplyEpilogue(kernels, epilogue, output, x0, y, stripWidth);
     }
 }
 
-void ConvolveSeparableTranspose(
+void ConvolveGaussianRecursive(
+    c_PaddedArrayPtr<const float> input,
+    c_PaddedArrayPtr<float> output,
+    float sigma
+)
+{
+    IMPPG_ASSERT(sigma >= 0.5f);
+    ThreadBuffers buffers;
+    ConvolveGaussianRecursive(input, output, CalculateYvVCoefficients(sigma), buffers);
+}
+
+static void ConvolveSeparable(
     c_PaddedArrayPtr<const float> input,
     c_PaddedArrayPtr<float> output,
     const float kernel[],
     int kernelRadius,
-    float tempBuf1[],
-    float tempBuf2[]
+    bool inputHasHalo, ///< If true, 'input' can be read up to 'kernelRadius'-1 elements beyond each border
+    ThreadBuffers& buffers,
+    const Epilogue& epilogue = NO_EPILOGUE,
+    const std::vector<std::uint8_t>* activeTiles = nullptr ///< If not null, tiles with a zero element are skipped
 )
 {
-    // NOTE: The function uses only half of 'kernel' (it is symmetrical), but passing the whole array may simplify vectorization in the future.
+    const int width = input.width(), height = input.height();
+    const int margin = kernelRadius - 1;
 
-    int width = input.width(), height = input.height();
+    const float* halfKernel = kernel + kernelRadius - 1;
+    const ConvolutionKernels& kernels = GetConvolutionKernels();
+    const ConvolveRowFn convolveRow = kernels.GetConvolveRow(kernelRadius);
+    const ConvolveColumnsFn convolveColumns = kernels.GetConvolveColumns(kernelRadius);
 
-    float* convRows = tempBuf1;
+    const int numTilesX = (width + CONVOLUTION_TILE_WIDTH - 1) / CONVOLUTION_TILE_WIDTH;
+    const int numTilesY = (height + CONVOLUTION_TILE_HEIGHT - 1) / CONVOLUTION_TILE_HEIGHT;
+    const int numTiles = numTilesX * numTilesY;
 
-    // All zero bits represents 0.0f
-    for (int i = 0; i < output.height(); i++)
-        memset(output.row(i), 0, output.GetBytesPerRow());
+    const std::size_t convRowsSize = CONVOLUTION_TILE_WIDTH * (CONVOLUTION_TILE_HEIGHT + 2 * margin);
+    const std::size_t paddedRowSize = CONVOLUTION_TILE_WIDTH + 2 * margin;
 
-    memset(convRows, 0, width*height*sizeof(float));
+    ReserveThreadBuffers(buffers);
 
-    if (width > 2*(kernelRadius-1))
+    #pragma omp parallel
     {
-        // Convolve each row
-        #pragma omp parallel for
-        for (int y = 0; y < height; y++)
+        float* scratch = GetThreadBuffer(buffers, convRowsSize + paddedRowSize);
+        // Contents of a tile (with the vertical halo) after the horizontal pass
+        float* convRows = scratch;
+        // Input row fragment with the horizontal halo, used for tiles touching the left or right image border
+        float* paddedRow = scratch + convRowsSize;
+
+        #pragma omp for schedule(dynamic)
+        for (int tileIdx = 0; tileIdx < numTiles; tileIdx++)
         {
-            Convolve1Dstep_OfsZero(input.row_const(y) + kernelRadius - 1,
-                    convRows + kernelRadius - 1 + y*width,
-                    width - 2 * (kernelRadius - 1),
-                    kernel[kernelRadius - 1]);
+            if (activeTiles && !(*activeTiles)[tileIdx])
+                continue;
+
+            const int x0 = (tileIdx % numTilesX) * CONVOLUTION_TILE_WIDTH;
+            const int y0 = (tileIdx / numTilesX) * CONVOLUTION_TILE_HEIGHT;
+            const int tileWidth = std::min(CONVOLUTION_TILE_WIDTH, width - x0);
+            const int tileHeight = std::min(CONVOLUTION_TILE_HEIGHT, height - y0);
+            const int numRows = tileHeight + 2 * margin; // including the vertical halo
+
+            const bool touchesBorder = !inputHasHalo && (x0 < margin || x0 + tileWidth + margin > width);
+
+            // Convolve the tile's rows; rows beyond the image replicate the border rows
+            for (int i = 0; i < numRows; i++)
+            {
+                const int srcY = y0 - margin + i;
+                const float* srcRow = input.row_const(inputHasHalo ? srcY : std::clamp(srcY, 0, height - 1));
+                if (touchesBorder)
+                {
+                    for (int x = 0; x < tileWidth + 2 * margin; x++)
+                        paddedRow[x] = srcRow[std::clamp(x0 - margin + x, 0, width - 1)];
+
+                    convolveRow(paddedRow + margin, &convRows[i * tileWidth], tileWidth, halfKernel, kernelRadius);
+                }
+                else
+                    convolveRow(srcRow + x0, &convRows[i * tileWidth], tileWidth, halfKernel, kernelRadius);
+            }
 
-            for (int i = 1; i <= kernelRadius - 1; i++)
+            // Convolve the tile's columns, vectorized across the columns; the epilogue is applied to each
+            // output row fragment while it is still in cache
+            for (int y = 0; y < tileHeight; y++)
             {
-                Convolve1Dstep_OfsNonZero(input.row_const(y) + kernelRadius - 1,
-                    convRows + kernelRadius - 1 + y*width,
-                    width - 2 * (kernelRadius - 1),
-                    kernel[i + kernelRadius - 1], i);
+                convolveColumns(&convRows[(y + margin) * tileWidth], tileWidth, output.row(y0 + y) + x0, tileWidth, halfKernel, kernelRadius);
+                ApplyEpilogue(kernels, epilogue, output, x0, y0 + y, tileWidth);
             }
         }
     }
+}
+
+void ConvolveSeparable(
+    c_PaddedArrayPtr<const float> input,
+    c_PaddedArrayPtr<float> output,
+    const float kernel[],
+    int kernelRadius
+)
+{
+    ThreadBuffers buffers;
+    ConvolveSeparable(input, output, kernel, kernelRadius, false, buffers);
+}
+
+void ConvolveSeparable(
+    const c_HaloImage& input,
+    c_PaddedArrayPtr<float> output,
+    const float kernel[],
+    int kernelRadius
+)
+{
+    IMPPG_ASSERT(input.GetHalo() >= kernelRadius - 1);
+    ThreadBuffers buffers;
+    ConvolveSeparable(input.GetInterior(), output, kernel, kernelRadius, true, buffers);
+}
+
+void c_HaloImage::Resize(int width, int height, int halo)
+{
+    m_Width = width;
+    m_Height = height;
+    m_Halo = halo;
+    m_Stride = width + 2 * halo;
+    m_Pixels.resize(static_cast<std::size_t>(m_Stride) * (height + 2 * halo));
+}
+
+void c_HaloImage::FillHalo()
+{
+    if (m_Halo == 0)
+        return;
+
+    c_PaddedArrayPtr<float> interior = GetInterior();
+
+    #pragma omp parallel for
+    for (int y = 0; y < m_Height; y++)
+    {
+        float* row = interior.row(y);
+        std::fill(row - m_Halo, row, row[0]);
+        std::fill(row + m_Width, row + m_Width + m_Halo, row[m_Width - 1]);
+    }
 
-    // For near-border elements assume the border values are replicated outside of array
-    for (int y = 0; y < height; y++)
+    // Whole rows (including the left and right halo) are copied, which also fills the corners
+    #pragma omp parallel for
+    for (int i = 1; i <= m_Halo; i++)
     {
-        //Left border
-        for (int x = -kernelRadius + 1; x <= kernelRadius - 2; x++)
+        std::copy_n(interior.row(0) - m_Halo, m_Stride, interior.row(-i) - m_Halo);
+        std::copy_n(interior.row(m_Height - 1) - m_Halo, m_Stride, interior.row(m_Height - 1 + i) - m_Halo);
+    }
+}
+
+/// Returns radii of boxes whose successive application approximates a Gaussian with the specified sigma.
+/** Box widths are chosen as in: W. M. Wells, "Efficient synthesis of Gaussian filters by cascaded uniform filters",
+    IEEE Trans. PAMI, 1986; all widths are odd and differ by at most 2, so that the total variance equals sigma^2
+    as closely as possible. */
+static std::vector<int> GetStackedBoxRadii(float sigma, int numBoxes)
+{
+    const float variance = sigma * sigma;
+    const float idealWidth = std::sqrt(12.0f * variance / numBoxes + 1.0f);
+    int lowerWidth = static_cast<int>(std::floor(idealWidth));
+    if (lowerWidth % 2 == 0)
+        lowerWidth--;
+
+    // Number of boxes which use 'lowerWidth'; the rest use 'lowerWidth + 2'
+    const int numLower = static_cast<int>(std::lround(
+        (12.0f * variance - numBoxes * lowerWidth * lowerWidth - 4 * numBoxes * lowerWidth - 3 * numBoxes) / (-4.0f * lowerWidth - 4.0f)));
+
+    std::vector<int> radii(numBoxes);
+    for (int i = 0; i < numBoxes; i++)
+        radii[i] = (i < numLower ? lowerWidth : lowerWidth + 2) / 2;
+
+    return radii;
+}
+
+static void ConvolveStackedBox(
+    c_PaddedArrayPtr<const float> input,
+    c_PaddedArrayPtr<float> output,
+    const std::vector<int>& radii,
+    ThreadBuffers& buffers,
+    const Epilogue& epilogue = NO_EPILOGUE
+)
+{
+    const int width = input.width(), height = input.height();
+    const int numBoxes = static_cast<int>(radii.size());
+    const int maxRadius = *std::max_element(radii.begin(), radii.end());
+    const ConvolutionKernels& kernels = GetConvolutionKernels();
+
+    // Convolve rows
+    ProcessRowBatches(height, buffers, 2 * (width + 2 * maxRadius) * MAX_SIMD_WIDTH,
+        [&](int y) { return input.row_const(y); },
+        [&](int y) { return output.row(y); },
+        [&](const float* const inputRows[], float* const outputRows[], int numRows, float scratch[])
         {
-            for (int i = 0; i < kernelRadius; i++)
-            {
-                float influence = input.row_const(y)[std::max(x - i, 0)] * kernel[i + (kernelRadius - 1)];
+            kernels.boxFilterRows(inputRows, outputRows, numRows, width, radii.data(), numBoxes, scratch);
+        });
 
-                if (x + i >= 0 && x + i < width)
-                    convRows[(x + i) + y*width] += influence;
-                if (x - i >= 0 && x - i < width && i != 0)
-                    convRows[(x - i) + y*width] += influence;
-            }
-        }
+    // Convolve columns in place; each thread filters a strip of columns, walking the rows in order
+    constexpr int STRIP_WIDTH = 64;
+    const int numStrips = (width + STRIP_WIDTH - 1) / STRIP_WIDTH;
+
+    #pragma omp parallel
+    {
+        float* scratch = GetThreadBuffer(buffers, (2 * maxRadius + 2) * STRIP_WIDTH);
 
-        // Right border
-        for (int x = width - (kernelRadius - 1); x <= width + kernelRadius - 1; x++)
+        #pragma omp for
+        for (int strip = 0; strip < numStrips; strip++)
         {
-            for (int i = 0; i < kernelRadius; i++)
-            {
-                float influence = input.row_const(y)[std::min(x + i, width - 1)] * kernel[i + (kernelRadius - 1)];
-                if (x + i < width && x + i >= 0)
-                    convRows[(x + i) + y*width] += influence;
-                if (x - i < width && x - i >= 0 && i != 0)
-                    convRows[(x - i) + y*width] += influence;
-            }
+            const int x0 = strip * STRIP_WIDTH;
+            const int stripWidth = std::min(STRIP_WIDTH, width - x0);
+            kernels.boxFilterColumns(output.row(0) + x0, output.GetBytesPerRow(), stripWidth, height,
+                radii.data(), numBoxes, scratch);
+            for (int y = 0; y < height; y++)
+                ApplyEpilogue(kernels, epilogue, output, x0, y, stripWidth);
         }
     }
+}
+
+void ConvolveStackedBox(
+    c_PaddedArrayPtr<const float> input,
+    c_PaddedArrayPtr<float> output,
+    float sigma
+)
+{
+    ThreadBuffers buffers;
+    ConvolveStackedBox(input, output, GetStackedBoxRadii(sigma, STACKED_BOX_NUM_BOXES), buffers);
+}
+
+void c_ConvolutionPlan::Prepare(int width, int height, float sigma, ConvolutionMethod method)
+{
+    if (IsPreparedFor(width, height, sigma, method))
+        return;
 
-    // Convolve each column
+    m_Width = width;
+    m_Height = height;
+    m_Sigma = sigma;
+    m_RequestedMethod = method;
 
-    //For near-border elements assume the border values are replicated outside of array
-    for (int x = 0; x < width; x++)
+    const int kernelRadius = static_cast<int>(ceil(sigma * 3.0f));
+
+    if (method == ConvolutionMethod::AUTO)
     {
-        // Top border
-        for (int y = -kernelRadius + 1; y <= kernelRadius - 2; y++)
-        {
-            for (int i = 0; i < kernelRadius; i++)
-            {
-                float influence = convRows[x + std::max(y - i, 0) * width] * kernel[i + (kernelRadius - 1)];
+        if (kernelRadius < GetCalibratedYoungVanVlietMinKernelRadius(width, height))
+            m_Method = ConvolutionMethod::STANDARD;
+        else if (sigma < STACKED_BOX_MIN_SIGMA)
+            m_Method = ConvolutionMethod::YOUNG_VAN_VLIET;
+        else
+            m_Method = ConvolutionMethod::STACKED_BOX;
+    }
+    else
+        m_Method = method;
 
-                if (y + i >= 0 && y + i < height)
-                    output.row(x)[(y + i)] += influence; // 'output' is a transposed array
-                if (y - i >= 0 && y - i < height && i != 0)
-                    output.row(x)[(y - i)] += influence; // 'output' is a transposed array
-            }
-        }
+    switch (m_Method)
+    {
+    case ConvolutionMethod::STANDARD:
+        m_KernelRadius = kernelRadius;
+        m_Kernel.resize(2 * kernelRadius - 1);
+        CalculateGaussianKernelProjection(m_Kernel.data(), kernelRadius, sigma, true);
+        break;
+
+    case ConvolutionMethod::YOUNG_VAN_VLIET:
+        IMPPG_ASSERT(sigma >= 0.5f);
+        m_YvVCoefficients = CalculateYvVCoefficients(sigma);
+        break;
+
+    case ConvolutionMethod::STACKED_BOX:
+        m_BoxRadii = GetStackedBoxRadii(sigma, STACKED_BOX_NUM_BOXES);
+        break;
+
+    default: IMPPG_ABORT();
+    }
+}
 
-        // Bottom border
-        for (int y = height - (kernelRadius - 1); y <= height + kernelRadius - 1; y++)
-        {
-            for (int i = 0; i < kernelRadius; i++)
-            {
-                float influence = convRows[x + std::min(y + i, height - 1)*width] * kernel[i + (kernelRadius - 1)];
-                if (y + i < height && y + i >= 0)
-                    output.row(x)[(y + i)] += influence; // 'output' is a transposed array
-                if (y - i < height && y - i >= 0 && i != 0)
-                    output.row(x)[(y - i)] += influence; // 'output' is a transposed array
-            }
-        }
+void c_ConvolutionPlan::ExecuteImpl(
+    c_PaddedArrayPtr<const float> input,
+    bool inputHasHalo,
+    c_PaddedArrayPtr<float> output,
+    ConvolutionEpilogue epilogue,
+    c_PaddedArrayPtr<const float> operand
+)
+{
+    IMPPG_ASSERT(input.width() == m_Width && input.height() == m_Height);
+    IMPPG_ASSERT(output.width() == m_Width && output.height() == m_Height);
+    IMPPG_ASSERT(epilogue == ConvolutionEpilogue::NONE || (operand.width() == m_Width && operand.height() == m_Height));
+    IMPPG_ASSERT(epilogue == ConvolutionEpilogue::NONE || !Overlap(operand, output));
+
+    const Epilogue epilogueParams{ epilogue, operand };
+
+    switch (m_Method)
+    {
+    case ConvolutionMethod::STANDARD:
+        ConvolveSeparable(input, output, m_Kernel.data(), m_KernelRadius, inputHasHalo, m_ThreadBuffers, epilogueParams);
+        break;
+
+    case ConvolutionMethod::YOUNG_VAN_VLIET:
+        ConvolveGaussianRecursive(input, output, m_YvVCoefficients, m_ThreadBuffers, epilogueParams);
+        break;
+
+    case ConvolutionMethod::STACKED_BOX:
+        ConvolveStackedBox(input, output, m_BoxRadii, m_ThreadBuffers, epilogueParams);
+        break;
+
+    default: IMPPG_ABORT();
     }
+}
 
-    // Before convolving rest of the columns, perform a transposition so we can convolve rows instead (faster due to sequential memory access)
+void c_ConvolutionPlan::ExecuteMasked(
+    c_PaddedArrayPtr<const float> input,
+    c_PaddedArrayPtr<float> output,
+    c_PaddedArrayPtr<const std::uint8_t> mask
+)
+{
+    IMPPG_ASSERT(mask.width() == m_Width && mask.height() == m_Height);
 
-    float* convRowsT = tempBuf2;
-    Transpose<float>(convRows, convRowsT, width, height, width * sizeof(float), height * sizeof(float), TRANSPOSITION_BLOCK_SIZE);
+    if (m_Method != ConvolutionMethod::STANDARD)
+    {
+        Execute(input, output);
+        return;
+    }
+
+    IMPPG_ASSERT(input.width() == m_Width && input.height() == m_Height);
+    IMPPG_ASSERT(output.width() == m_Width && output.height() == m_Height);
 
-    if (height > 2*(kernelRadius-1))
+    // Find the tiles (laid out as in 'ConvolveSeparable') containing any masked element
+    const int numTilesX = (m_Width + CONVOLUTION_TILE_WIDTH - 1) / CONVOLUTION_TILE_WIDTH;
+    const int numTilesY = (m_Height + CONVOLUTION_TILE_HEIGHT - 1) / CONVOLUTION_TILE_HEIGHT;
+    std::vector<std::uint8_t> activeTiles(static_cast<std::size_t>(numTilesX) * numTilesY, 0);
+
+    #pragma omp parallel for
+    for (int tileIdx = 0; tileIdx < numTilesX * numTilesY; tileIdx++)
     {
-        // Convolve each column (now: row)
-        #pragma omp parallel for
-        for (int y = 0; y < width; y++)
+        const int x0 = (tileIdx % numTilesX) * CONVOLUTION_TILE_WIDTH;
+        const int y0 = (tileIdx / numTilesX) * CONVOLUTION_TILE_HEIGHT;
+        const int tileWidth = std::min(CONVOLUTION_TILE_WIDTH, m_Width - x0);
+        const int tileHeight = std::min(CONVOLUTION_TILE_HEIGHT, m_Height - y0);
+        for (int y = y0; y < y0 + tileHeight && !activeTiles[tileIdx]; y++)
         {
-            Convolve1Dstep_OfsZero(convRowsT + kernelRadius - 1 + y*height,
-                output.row(y) + kernelRadius - 1,
-                height - 2 * (kernelRadius - 1),
-                kernel[kernelRadius - 1]);
-
-            for (int i = 1; i <= kernelRadius - 1; i++)
-            {
-                Convolve1Dstep_OfsNonZero(convRowsT + kernelRadius - 1 + y*height,
-                    output.row(y) + kernelRadius - 1,
-                    height - 2 * (kernelRadius - 1),
-                    kernel[i + kernelRadius - 1], i);
-            }
+            const std::uint8_t* maskRow = mask.row_const(y) + x0;
+            activeTiles[tileIdx] = std::any_of(maskRow, maskRow + tileWidth, [](std::uint8_t value) { return value != 0; });
         }
     }
 
-    // The caller expects a transposed output, so we can leave it as is.
+    ConvolveSeparable(input, output, m_Kernel.data(), m_KernelRadius, false, m_ThreadBuffers, NO_EPILOGUE, &activeTiles);
+}
+
+void c_ConvolutionPlan::Execute(c_PaddedArrayPtr<const float> input, c_PaddedArrayPtr<float> output)
+{
+    ExecuteImpl(input, false, output, ConvolutionEpilogue::NONE, NO_EPILOGUE.operand);
 }
 
+void c_ConvolutionPlan::Execute(const c_HaloImage& input, c_PaddedArrayPtr<float> output)
+{
+    Execute(input, output, ConvolutionEpilogue::NONE, NO_EPILOGUE.operand);
+}
+
+void c_ConvolutionPlan::Execute(
+    const c_HaloImage& input,
+    c_PaddedArrayPtr<float> output,
+    ConvolutionEpilogue epilogue,
+    c_PaddedArrayPtr<const float> operand
+)
+{
+    IMPPG_ASSERT(input.GetHalo() >= GetRequiredHalo());
+    ExecuteImpl(input.GetInterior(), m_Method == ConvolutionMethod::STANDARD, output, epilogue, operand);
+}
 
 void ConvolveSeparable(
     c_PaddedArrayPtr<const float> input,
@@ -294,30 +592,53 @@ void ConvolveSeparable(
     float sigma
 )
 {
-    int width = input.width(), height = input.height();
-    int kernelRadius = static_cast<int>(ceil(sigma * 3.0f));
-
-    std::unique_ptr<float[]> outputT(new float[input.height() * input.width()]); // transposed output
-    std::unique_ptr<float[]> temp1(new float[input.width() * input.height()]);
-    std::unique_ptr<float[]> temp2(new float[input.width() * input.height()]);
+    c_ConvolutionPlan plan(input.width(), input.height(), sigma);
+    plan.Execute(input, output);
+}
 
-    if (kernelRadius < YOUNG_VAN_VLIET_MIN_KERNEL_RADIUS)
+int CalibrateYoungVanVlietMinKernelRadius(int width, int height)
+{
+    std::vector<float> input(static_cast<std::size_t>(width) * height);
+    std::vector<float> output(input.size());
+    for (std::size_t i = 0; i < input.size(); i++)
+        input[i] = static_cast<float>(i * 7919 % 1013) / 1013;
+
+    // Returns the shortest of several execution times (in seconds); the first run is not timed,
+    // so that the scratch buffers are already allocated
+    const auto measure = [&](c_ConvolutionPlan& plan)
     {
-        std::unique_ptr<float[]> kernel(new float[2 * kernelRadius - 1]);
-        CalculateGaussianKernelProjection(kernel.get(), kernelRadius, sigma, true);
+        constexpr int NUM_RUNS = 3;
+        const auto inputArray = c_PaddedArrayPtr<const float>(input.data(), width, height);
+        const auto outputArray = c_PaddedArrayPtr<float>(output.data(), width, height);
 
-        ConvolveSeparableTranspose(
-                input,
-                c_PaddedArrayPtr<float>(outputT.get(), height, width),
-                kernel.get(), kernelRadius, temp1.get(), temp2.get());
-    }
-    else
+        plan.Execute(inputArray, outputArray);
+        double shortest = 0.0;
+        for (int i = 0; i < NUM_RUNS; i++)
+        {
+            const auto tStart = std::chrono::steady_clock::now();
+            plan.Execute(inputArray, outputArray);
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+            shortest = (i == 0) ? elapsed : std::min(shortest, elapsed);
+        }
+        return shortest;
+    };
+
+    // For a given kernel radius r, use the sigma for which ceil(3*sigma) = r
+
+    // Execution time of the recursive filter does not depend on sigma
+    c_ConvolutionPlan yvvPlan(width, height, (CONVOLUTION_CALIBRATION_MAX_KERNEL_RADIUS - 0.5f) / 3, ConvolutionMethod::YOUNG_VAN_VLIET);
+    const double yvvTime = measure(yvvPlan);
+
+    c_ConvolutionPlan standardPlan;
+    bool previousSlower = false; // whether STANDARD was slower for the previous radius
+    for (int radius = CONVOLUTION_CALIBRATION_MIN_KERNEL_RADIUS; radius <= CONVOLUTION_CALIBRATION_MAX_KERNEL_RADIUS; radius++)
     {
-        ConvolveGaussianRecursiveTranspose(
-                input,
-                c_PaddedArrayPtr<float>(outputT.get(), height, width),
-                sigma, temp1.get(), temp2.get());
+        standardPlan.Prepare(width, height, (radius - 0.5f) / 3, ConvolutionMethod::STANDARD);
+        const bool slower = measure(standardPlan) > yvvTime;
+        if (slower && previousSlower)
+            return radius - 1;
+        previousSlower = slower;
     }
 
-    Transpose(outputT.get(), output.row(0), height, width, height*sizeof(float), output.GetBytesPerRow(), TRANSPOSITION_BLOCK_SIZE);
+    return CONVOLUTION_CALIBRATION_MAX_KERNEL_RADIUS + 1;
 }
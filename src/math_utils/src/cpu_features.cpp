@@ -0,0 +1,96 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    CPU features detection implementation.
+*/
+
+#include "math_utils/cpu_features.h"
+
+#if IMPPG_X86_SIMD && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static SimdLevel DetectSimdLevel()
+{
+#if IMPPG_X86_SIMD
+
+#if defined(_MSC_VER)
+    int regs[4]{};
+    __cpuid(regs, 0);
+    const int maxLeaf = regs[0];
+
+    __cpuid(regs, 1);
+    const bool sse41   = (regs[2] & (1 << 19)) != 0;
+    const bool fma     = (regs[2] & (1 << 12)) != 0;
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+
+    // Check if the OS saves the YMM (and ZMM) registers' state on context switches
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    const bool ymmEnabled = (xcr0 & 0x06) == 0x06;
+    const bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+    bool avx2 = false, avx512f = false;
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(regs, 7, 0);
+        avx2    = (regs[1] & (1 << 5)) != 0;
+        avx512f = (regs[1] & (1 << 16)) != 0;
+    }
+
+    if (avx512f && zmmEnabled)
+        return SimdLevel::AVX512;
+    else if (avx2 && fma && ymmEnabled)
+        return SimdLevel::AVX2;
+    else if (sse41)
+        return SimdLevel::SSE4;
+#else
+    // GCC and Clang also verify that the OS supports the extended register state
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdLevel::AVX512;
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::AVX2;
+    else if (__builtin_cpu_supports("sse4.1"))
+        return SimdLevel::SSE4;
+#endif
+
+#endif // IMPPG_X86_SIMD
+
+    return SimdLevel::SCALAR;
+}
+
+SimdLevel GetSimdLevel()
+{
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::SCALAR: return "scalar";
+    case SimdLevel::SSE4:   return "SSE4.1";
+    case SimdLevel::AVX2:   return "AVX2";
+    case SimdLevel::AVX512: return "AVX-512";
+    default:                return "unknown";
+    }
+}
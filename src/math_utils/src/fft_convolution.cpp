@@ -0,0 +1,414 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Frequency-domain convolution implementation.
+*/
+
+#include "math_utils/fft_convolution.h"
+#include "conv_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "../../imppg_assert.h"
+
+/// Number of columns transformed together by 'TransformColumns'.
+/** The vertical transform walks whole strips of rows (vectorized across the strip's columns),
+    so a strip of the full image height should fit in L2 cache. */
+constexpr int FFT_COLUMN_STRIP_WIDTH = 16;
+
+static int GetNextPowerOf2(int value)
+{
+    int result = 1;
+    while (result < value)
+        result *= 2;
+    return result;
+}
+
+void c_FFTConvolution::FFTTables::Prepare(int len)
+{
+    if (length == len)
+        return;
+
+    length = len;
+
+    int numBits = 0;
+    while ((1 << numBits) < len)
+        numBits++;
+
+    bitReversed.resize(len);
+    for (int i = 0; i < len; i++)
+    {
+        int reversed = 0;
+        for (int bit = 0; bit < numBits; bit++)
+            if (i & (1 << bit))
+                reversed |= 1 << (numBits - 1 - bit);
+        bitReversed[i] = reversed;
+    }
+
+    twiddles.resize(len / 2);
+    for (int k = 0; k < len / 2; k++)
+    {
+        const double angle = -2.0 * 3.14159265358979323846 * k / len;
+        twiddles[k] = std::complex<float>(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+    }
+}
+
+/// Performs in-place radix-2 transform of 'tables.length' elements, each being a group of 'numLanes' consecutive
+/// complex values (i.e. 'numLanes' independent transforms at once), with groups 'stride' values apart.
+/** The inverse transform is not normalized. */
+void c_FFTConvolution::TransformLanes(
+    std::complex<float> data[], std::ptrdiff_t stride, int numLanes, const FFTTables& tables, bool inverse)
+{
+    const int length = tables.length;
+
+    for (int i = 0; i < length; i++)
+    {
+        const int j = tables.bitReversed[i];
+        if (i < j)
+            std::swap_ranges(data + i * stride, data + i * stride + numLanes, data + j * stride);
+    }
+
+    for (int blockLength = 2; blockLength <= length; blockLength *= 2)
+    {
+        const int half = blockLength / 2;
+        const int twiddleStep = length / blockLength;
+        for (int start = 0; start < length; start += blockLength)
+        {
+            for (int k = 0; k < half; k++)
+            {
+                const std::complex<float> w = tables.twiddles[k * twiddleStep];
+                const float wr = w.real();
+                const float wi = inverse ? -w.imag() : w.imag();
+
+                // Complex arithmetic is spelled out, so that it vectorizes and avoids the NaN checks of std::complex
+                float* a = reinterpret_cast<float*>(data + (start + k) * stride);
+                float* b = reinterpret_cast<float*>(data + (start + k + half) * stride);
+                for (int l = 0; l < 2 * numLanes; l += 2)
+                {
+                    const float tr = wr * b[l] - wi * b[l + 1];
+                    const float ti = wr * b[l + 1] + wi * b[l];
+                    b[l] = a[l] - tr;
+                    b[l + 1] = a[l + 1] - ti;
+                    a[l] += tr;
+                    a[l + 1] += ti;
+                }
+            }
+        }
+    }
+}
+
+void c_FFTConvolution::ForwardRowPair(
+    std::complex<float> row[], std::complex<float> spectrumA[], std::complex<float> spectrumB[]) const
+{
+    TransformLanes(row, 1, 1, m_RowTables, false);
+
+    // With z = a + ib, the spectra of the real rows are A[k] = (Z[k] + conj(Z[N-k]))/2, B[k] = (Z[k] - conj(Z[N-k]))/2i
+    for (int k = 0; k < m_SpectrumWidth; k++)
+    {
+        const std::complex<float> zk = row[k];
+        const std::complex<float> znk = std::conj(row[(m_PaddedWidth - k) & (m_PaddedWidth - 1)]);
+        const float sumRe = zk.real() + znk.real(), sumIm = zk.imag() + znk.imag();
+        const float diffRe = zk.real() - znk.real(), diffIm = zk.imag() - znk.imag();
+        spectrumA[k] = std::complex<float>(0.5f * sumRe, 0.5f * sumIm);
+        spectrumB[k] = std::complex<float>(0.5f * diffIm, -0.5f * diffRe);
+    }
+}
+
+void c_FFTConvolution::InverseRowPair(
+    const std::complex<float> spectrumA[], const std::complex<float> spectrumB[], std::complex<float> row[]) const
+{
+    // Restore the full spectra of the real rows (A[N-k] = conj(A[k])) and pack them as Z = A + iB
+    for (int k = 0; k < m_SpectrumWidth; k++)
+        row[k] = std::complex<float>(
+            spectrumA[k].real() - spectrumB[k].imag(),
+            spectrumA[k].imag() + spectrumB[k].real());
+
+    for (int k = m_SpectrumWidth; k < m_PaddedWidth; k++)
+    {
+        const std::complex<float> a = spectrumA[m_PaddedWidth - k];
+        const std::complex<float> b = spectrumB[m_PaddedWidth - k];
+        row[k] = std::complex<float>(a.real() + b.imag(), -a.imag() + b.real());
+    }
+
+    TransformLanes(row, 1, 1, m_RowTables, true);
+}
+
+void c_FFTConvolution::TransformColumns(std::complex<float> data[], bool inverse) const
+{
+    const int numStrips = (m_SpectrumWidth + FFT_COLUMN_STRIP_WIDTH - 1) / FFT_COLUMN_STRIP_WIDTH;
+
+    #pragma omp parallel for
+    for (int strip = 0; strip < numStrips; strip++)
+    {
+        const int x0 = strip * FFT_COLUMN_STRIP_WIDTH;
+        TransformLanes(data + x0, m_SpectrumWidth, std::min(FFT_COLUMN_STRIP_WIDTH, m_SpectrumWidth - x0), m_ColumnTables, inverse);
+    }
+}
+
+#ifndef NDEBUG
+/// Checks the results of 'c_FFTConvolution::Execute' against a direct spatial convolution (with replicated borders)
+/// of an odd-sized image with an asymmetric kernel, for both kernel orientations and with an epilogue.
+static void VerifyFFTConvolution()
+{
+    constexpr int WIDTH = 37, HEIGHT = 23;
+    const std::vector<float> kernelX{ 0.1f, 0.3f, 0.2f, 0.25f, 0.15f };
+    const std::vector<float> kernelY{ 0.05f, 0.1f, 0.2f, 0.3f, 0.15f, 0.12f, 0.08f };
+    const int kernelWidth = static_cast<int>(kernelX.size()), kernelHeight = static_cast<int>(kernelY.size());
+    const int radiusX = kernelWidth / 2, radiusY = kernelHeight / 2;
+
+    std::vector<float> kernel(kernelWidth * kernelHeight);
+    for (int y = 0; y < kernelHeight; y++)
+        for (int x = 0; x < kernelWidth; x++)
+            kernel[y * kernelWidth + x] = kernelY[y] * kernelX[x];
+
+    std::vector<float> input(WIDTH * HEIGHT), operand(WIDTH * HEIGHT);
+    for (int i = 0; i < WIDTH * HEIGHT; i++)
+    {
+        input[i] = 0.1f + static_cast<float>((i * 7919) % 113) / 113.0f;
+        operand[i] = 0.2f + static_cast<float>((i * 6007) % 101) / 101.0f;
+    }
+
+    c_FFTConvolution fftConv;
+    fftConv.Prepare(WIDTH, HEIGHT, c_PaddedArrayPtr<const float>(kernel.data(), kernelWidth, kernelHeight));
+
+    std::vector<float> output(WIDTH * HEIGHT);
+    for (const bool flipped: { false, true })
+    {
+        for (const ConvolutionEpilogue epilogue: { ConvolutionEpilogue::NONE, ConvolutionEpilogue::DIVIDE_INTO, ConvolutionEpilogue::MULTIPLY })
+        {
+            fftConv.Execute(
+                c_PaddedArrayPtr<const float>(input.data(), WIDTH, HEIGHT),
+                c_PaddedArrayPtr<float>(output.data(), WIDTH, HEIGHT),
+                flipped,
+                epilogue,
+                c_PaddedArrayPtr<const float>(operand.data(), WIDTH, HEIGHT)
+            );
+
+            const int sign = flipped ? 1 : -1;
+            for (int y = 0; y < HEIGHT; y++)
+                for (int x = 0; x < WIDTH; x++)
+                {
+                    double expected = 0.0;
+                    for (int dy = -radiusY; dy <= radiusY; dy++)
+                        for (int dx = -radiusX; dx <= radiusX; dx++)
+                        {
+                            const int srcX = std::clamp(x + sign * dx, 0, WIDTH - 1);
+                            const int srcY = std::clamp(y + sign * dy, 0, HEIGHT - 1);
+                            expected += kernel[(dy + radiusY) * kernelWidth + dx + radiusX] * input[srcY * WIDTH + srcX];
+                        }
+                    if (epilogue == ConvolutionEpilogue::DIVIDE_INTO)
+                        expected = operand[y * WIDTH + x] / (expected + CONVOLUTION_DIVISION_EPSILON);
+                    else if (epilogue == ConvolutionEpilogue::MULTIPLY)
+                        expected *= operand[y * WIDTH + x];
+
+                    IMPPG_ASSERT(std::abs(output[y * WIDTH + x] - expected) <= 1.0e-4 * std::abs(expected));
+                }
+        }
+    }
+}
+#endif
+
+bool c_FFTConvolution::IsPreparedFor(int width, int height, c_PaddedArrayPtr<const float> kernel) const
+{
+    if (m_Width != width || m_Height != height || m_KernelWidth != kernel.width() || m_KernelHeight != kernel.height())
+        return false;
+
+    for (int y = 0; y < kernel.height(); y++)
+        if (!std::equal(kernel.row_const(y), kernel.row_const(y) + kernel.width(), m_Kernel.begin() + y * m_KernelWidth))
+            return false;
+
+    return true;
+}
+
+void c_FFTConvolution::Prepare(int width, int height, c_PaddedArrayPtr<const float> kernel)
+{
+    IMPPG_ASSERT(width > 0 && height > 0);
+    IMPPG_ASSERT(kernel.width() % 2 == 1 && kernel.height() % 2 == 1);
+
+#ifndef NDEBUG
+    // The check itself calls 'Prepare'; concurrent first callers do not wait for it
+    static std::atomic<bool> verificationStarted{false};
+    if (!verificationStarted.exchange(true))
+        VerifyFFTConvolution();
+#endif
+
+    if (IsPreparedFor(width, height, kernel))
+        return;
+
+    m_Width = width;
+    m_Height = height;
+    m_KernelWidth = kernel.width();
+    m_KernelHeight = kernel.height();
+    m_Kernel.resize(m_KernelWidth * m_KernelHeight);
+    for (int y = 0; y < m_KernelHeight; y++)
+        std::copy_n(kernel.row_const(y), m_KernelWidth, m_Kernel.begin() + y * m_KernelWidth);
+
+    const int radiusX = m_KernelWidth / 2;
+    const int radiusY = m_KernelHeight / 2;
+    // The packing of real rows in pairs needs at least 2 rows and columns
+    m_PaddedWidth = GetNextPowerOf2(std::max(2, width + 2 * radiusX));
+    m_PaddedHeight = GetNextPowerOf2(std::max(2, height + 2 * radiusY));
+    m_SpectrumWidth = m_PaddedWidth / 2 + 1;
+    m_RowTables.Prepare(m_PaddedWidth);
+    m_ColumnTables.Prepare(m_PaddedHeight);
+
+    const std::size_t numElements = static_cast<std::size_t>(m_SpectrumWidth) * m_PaddedHeight;
+    m_Buffer.resize(numElements);
+    m_KernelSpectrum.resize(numElements);
+
+    std::complex<float>* const spectrum = m_KernelSpectrum.data();
+    const float scale = 1.0f / (static_cast<float>(m_PaddedWidth) * m_PaddedHeight);
+
+    #pragma omp parallel
+    {
+        std::vector<std::complex<float>> row(m_PaddedWidth);
+
+        #pragma omp for
+        for (int y = 0; y < m_PaddedHeight; y += 2)
+        {
+            std::fill(row.begin(), row.end(), 0.0f);
+            for (int i = 0; i < 2; i++)
+            {
+                // Place the kernel's center at (0, 0), wrapping the negative offsets around
+                const int ky = (y + i + radiusY) % m_PaddedHeight;
+                if (ky >= m_KernelHeight)
+                    continue;
+
+                for (int kx = 0; kx < m_KernelWidth; kx++)
+                {
+                    const int x = (kx - radiusX + m_PaddedWidth) % m_PaddedWidth;
+                    const float value = scale * m_Kernel[ky * m_KernelWidth + kx];
+                    row[x] += (i == 0) ? std::complex<float>(value, 0.0f) : std::complex<float>(0.0f, value);
+                }
+            }
+            ForwardRowPair(row.data(), spectrum + y * m_SpectrumWidth, spectrum + (y + 1) * m_SpectrumWidth);
+        }
+    }
+
+    TransformColumns(spectrum, false);
+}
+
+void c_FFTConvolution::Execute(
+    c_PaddedArrayPtr<const float> input,
+    c_PaddedArrayPtr<float> output,
+    bool flippedKernel)
+{
+    Execute(input, output, flippedKernel, ConvolutionEpilogue::NONE, input);
+}
+
+void c_FFTConvolution::Execute(
+    c_PaddedArrayPtr<const float> input,
+    c_PaddedArrayPtr<float> output,
+    bool flippedKernel,
+    ConvolutionEpilogue epilogue,
+    c_PaddedArrayPtr<const float> operand)
+{
+    IMPPG_ASSERT(input.width() == m_Width && input.height() == m_Height);
+    IMPPG_ASSERT(output.width() == m_Width && output.height() == m_Height);
+    IMPPG_ASSERT(operand.width() == m_Width && operand.height() == m_Height);
+    IMPPG_ASSERT(epilogue == ConvolutionEpilogue::NONE || !Overlap(operand, output));
+
+    std::complex<float>* const buf = m_Buffer.data();
+    const std::ptrdiff_t stride = m_SpectrumWidth;
+
+    // The image is placed at (0, 0). The padding to the right (and below) replicates the right (bottom) border
+    // in its first half and the left (top) border in its second half, as the latter is cyclically adjacent
+    // to the image's left (top) border.
+    const int rightPaddingEnd = m_Width + (m_PaddedWidth - m_Width) / 2;
+    const int bottomPaddingEnd = m_Height + (m_PaddedHeight - m_Height) / 2;
+
+    #pragma omp parallel
+    {
+        std::vector<std::complex<float>> row(m_PaddedWidth);
+
+        #pragma omp for
+        for (int y = 0; y < m_Height; y += 2)
+        {
+            // For an odd height, the last row is paired with itself (the second result goes to a padding row)
+            const float* srcA = input.row_const(y);
+            const float* srcB = input.row_const(std::min(y + 1, m_Height - 1));
+            for (int x = 0; x < m_Width; x++)
+                row[x] = std::complex<float>(srcA[x], srcB[x]);
+            std::fill(row.begin() + m_Width, row.begin() + rightPaddingEnd, std::complex<float>(srcA[m_Width - 1], srcB[m_Width - 1]));
+            std::fill(row.begin() + rightPaddingEnd, row.end(), std::complex<float>(srcA[0], srcB[0]));
+
+            ForwardRowPair(row.data(), buf + y * stride, buf + (y + 1) * stride);
+        }
+    }
+
+    // Padding rows are copies of the border rows, and so are their transforms
+    #pragma omp parallel for
+    for (int y = m_Height; y < m_PaddedHeight; y++)
+        std::copy_n(buf + (y < bottomPaddingEnd ? m_Height - 1 : 0) * stride, m_SpectrumWidth, buf + y * stride);
+
+    TransformColumns(buf, false);
+
+    #pragma omp parallel for
+    for (int y = 0; y < m_PaddedHeight; y++)
+    {
+        float* data = reinterpret_cast<float*>(buf + y * stride);
+        const float* kernel = reinterpret_cast<const float*>(m_KernelSpectrum.data() + y * stride);
+        const float sign = flippedKernel ? -1.0f : 1.0f;
+        for (int i = 0; i < 2 * m_SpectrumWidth; i += 2)
+        {
+            const float kr = kernel[i];
+            const float ki = sign * kernel[i + 1];
+            const float re = data[i] * kr - data[i + 1] * ki;
+            const float im = data[i] * ki + data[i + 1] * kr;
+            data[i] = re;
+            data[i + 1] = im;
+        }
+    }
+
+    TransformColumns(buf, true);
+
+    const ConvolutionKernels& kernels = GetConvolutionKernels();
+
+    #pragma omp parallel
+    {
+        std::vector<std::complex<float>> row(m_PaddedWidth);
+
+        // Only the rows containing the image need the final horizontal transform
+        #pragma omp for
+        for (int y = 0; y < m_Height; y += 2)
+        {
+            InverseRowPair(buf + y * stride, buf + (y + 1) * stride, row.data());
+
+            float* destA = output.row(y);
+            for (int x = 0; x < m_Width; x++)
+                destA[x] = row[x].real();
+            if (epilogue != ConvolutionEpilogue::NONE)
+                kernels.applyEpilogue(destA, operand.row_const(y), m_Width, epilogue);
+
+            if (y + 1 < m_Height)
+            {
+                float* destB = output.row(y + 1);
+                for (int x = 0; x < m_Width; x++)
+                    destB[x] = row[x].imag();
+                if (epilogue != ConvolutionEpilogue::NONE)
+                    kernels.applyEpilogue(destB, operand.row_const(y + 1), m_Width, epilogue);
+            }
+        }
+    }
+}
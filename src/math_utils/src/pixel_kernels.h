@@ -0,0 +1,77 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Low-level element-wise kernels header.
+*/
+
+#pragma once
+
+#include "math_utils/cpu_features.h"
+#include "math_utils/pixel_ops.h"
+
+#include <cstdint>
+#include <cstring>
+
+/// Returns true if 'value' is NaN; unlike 'std::isnan', works also with -ffast-math.
+inline bool IsNaN(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x7FFFFFFFu) > 0x7F800000u;
+}
+
+/// Set of low-level element-wise kernels compiled for a single instruction set.
+/** Each kernel processes `length` consecutive elements; see pixel_ops.h for the semantics. */
+struct PixelKernels
+{
+    SimdLevel simdLevel;
+
+    void (*blend)(const float input[], const float blurred[], float output[], int length, float amount);
+
+    void (*blendAdaptive)(
+        const float input[], const float blurred[], const float steering[], float output[], int length,
+        const CubicTransition& amount);
+
+    /// Clamps the values to [minValue; maxValue]; NaN becomes 'minValue'.
+    void (*clamp)(const float input[], float output[], int length, float minValue, float maxValue);
+
+    void (*interpolateLut)(const float values[], const float slopes[], int numSegments, const float input[], float output[], int length);
+
+    /// Sets data[i] *= factor[i].
+    void (*multiply)(float data[], const float factor[], int length);
+
+    /// Sets data[i] = clamp(a * data[i] + b, minValue, maxValue); NaN becomes 'minValue'.
+    void (*affineClamp)(float data[], int length, float a, float b, float minValue, float maxValue);
+
+    /// Updates `minValue` and `maxValue` with the extremes of `data`.
+    void (*findMinMax)(const float data[], int length, float& minValue, float& maxValue);
+};
+
+/// Returns kernels for the highest instruction set supported by the CPU (see `GetSimdLevel`).
+const PixelKernels& GetPixelKernels();
+
+/// Returns the non-vectorized reference kernels.
+const PixelKernels& GetScalarPixelKernels();
+
+#if IMPPG_X86_SIMD
+const PixelKernels& GetSSE4PixelKernels();
+const PixelKernels& GetAVX2PixelKernels();
+const PixelKernels& GetAVX512PixelKernels();
+#endif
@@ -0,0 +1,209 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Vectorized element-wise kernels templates.
+
+    Included by the per-instruction-set translation units (pixel_kernels_<ISA>.cpp) after simd.h;
+    `V` is one of the wrappers from simd.h.
+
+    NOTE: As in conv_kernels_impl.h, every function here must be a template depending on `V`
+    (hence e.g. `CubicTransition::operator()` and `std::min` are not used).
+*/
+
+#pragma once
+
+template<typename V>
+void Blend(const float input[], const float blurred[], float output[], int length, float amount)
+{
+    constexpr int W = V::WIDTH;
+    const typename V::Reg vAmount = V::Set1(amount);
+
+    int i = 0;
+    for (; i + W <= length; i += W)
+    {
+        const typename V::Reg b = V::Load(blurred + i);
+        V::Store(output + i, V::MulAdd(vAmount, V::Sub(V::Load(input + i), b), b));
+    }
+    for (; i < length; i++)
+        output[i] = blurred[i] + amount * (input[i] - blurred[i]);
+}
+
+template<typename V>
+void BlendAdaptive(
+    const float input[], const float blurred[], const float steering[], float output[], int length,
+    const CubicTransition& amount)
+{
+    using Reg = typename V::Reg;
+    constexpr int W = V::WIDTH;
+
+    const Reg start = V::Set1(amount.start), end = V::Set1(amount.end);
+    const Reg below = V::Set1(amount.valueBelow), above = V::Set1(amount.valueAbove);
+    const Reg a = V::Set1(amount.a), b = V::Set1(amount.b), c = V::Set1(amount.c), d = V::Set1(amount.d);
+
+    int i = 0;
+    for (; i + W <= length; i += W)
+    {
+        const Reg x = V::Load(steering + i);
+        Reg value = V::MulAdd(V::MulAdd(V::MulAdd(a, x, b), x, c), x, d);
+        value = V::Select(V::Less(x, start), below, value);
+        value = V::Select(V::Less(end, x), above, value);
+
+        const Reg blurredValue = V::Load(blurred + i);
+        V::Store(output + i, V::MulAdd(value, V::Sub(V::Load(input + i), blurredValue), blurredValue));
+    }
+    for (; i < length; i++)
+    {
+        const float x = steering[i];
+        float value;
+        if (x < amount.start)
+            value = amount.valueBelow;
+        else if (x > amount.end)
+            value = amount.valueAbove;
+        else
+            value = x * (x * (amount.a * x + amount.b) + amount.c) + amount.d;
+
+        output[i] = blurred[i] + value * (input[i] - blurred[i]);
+    }
+}
+
+template<typename V>
+void Clamp(const float input[], float output[], int length, float minValue, float maxValue)
+{
+    constexpr int W = V::WIDTH;
+    const typename V::Reg vMin = V::Set1(minValue), vMax = V::Set1(maxValue);
+
+    int i = 0;
+    for (; i + W <= length; i += W)
+    {
+        const typename V::Reg value = V::Load(input + i);
+        V::Store(output + i, V::Select(V::IsNaN(value), vMin, V::Min(V::Max(value, vMin), vMax)));
+    }
+    for (; i < length; i++)
+    {
+        const float value = input[i];
+        output[i] = IsNaN(value) ? minValue : (value < minValue ? minValue : (value > maxValue ? maxValue : value));
+    }
+}
+
+template<typename V>
+void InterpolateLut(const float values[], const float slopes[], int numSegments, const float input[], float output[], int length)
+{
+    using Reg = typename V::Reg;
+    constexpr int W = V::WIDTH;
+    const Reg zero = V::Zero(), one = V::Set1(1.0f);
+    const Reg vNumSegments = V::Set1(static_cast<float>(numSegments));
+    const Reg lastSegment = V::Set1(static_cast<float>(numSegments - 1));
+
+    int i = 0;
+    for (; i + W <= length; i += W)
+    {
+        // 'Max' returns its second argument for NaN inputs
+        const Reg x = V::Mul(V::Min(V::Max(V::Load(input + i), zero), one), vNumSegments);
+        // For x = 1 the last segment is used with fraction 1
+        const typename V::IntReg segment = V::Truncate(V::Min(x, lastSegment));
+        const Reg fraction = V::Sub(x, V::ToFloat(segment));
+        V::Store(output + i, V::MulAdd(fraction, V::Gather(slopes, segment), V::Gather(values, segment)));
+    }
+    for (; i < length; i++)
+    {
+        const float value = input[i];
+        const float x = (value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f) * numSegments;
+        const int segment = static_cast<int>(x < numSegments - 1 ? x : numSegments - 1);
+        output[i] = values[segment] + (x - segment) * slopes[segment];
+    }
+}
+
+template<typename V>
+void Multiply(float data[], const float factor[], int length)
+{
+    constexpr int W = V::WIDTH;
+
+    int i = 0;
+    for (; i + W <= length; i += W)
+        V::Store(data + i, V::Mul(V::Load(data + i), V::Load(factor + i)));
+    for (; i < length; i++)
+        data[i] *= factor[i];
+}
+
+template<typename V>
+void AffineClamp(float data[], int length, float a, float b, float minValue, float maxValue)
+{
+    constexpr int W = V::WIDTH;
+    const typename V::Reg vA = V::Set1(a), vB = V::Set1(b), vMin = V::Set1(minValue), vMax = V::Set1(maxValue);
+
+    int i = 0;
+    for (; i + W <= length; i += W)
+    {
+        const typename V::Reg value = V::MulAdd(vA, V::Load(data + i), vB);
+        V::Store(data + i, V::Select(V::IsNaN(value), vMin, V::Min(V::Max(value, vMin), vMax)));
+    }
+    for (; i < length; i++)
+    {
+        const float value = a * data[i] + b;
+        data[i] = IsNaN(value) ? minValue : (value < minValue ? minValue : (value > maxValue ? maxValue : value));
+    }
+}
+
+template<typename V>
+void UpdateMinMax(const float data[], int length, float& minValue, float& maxValue)
+{
+    constexpr int W = V::WIDTH;
+
+    int i = 0;
+    if (length >= W)
+    {
+        typename V::Reg vMin = V::Set1(minValue), vMax = V::Set1(maxValue);
+        for (; i + W <= length; i += W)
+        {
+            const typename V::Reg values = V::Load(data + i);
+            vMin = V::Min(vMin, values);
+            vMax = V::Max(vMax, values);
+        }
+
+        float lanes[W];
+        V::Store(lanes, vMin);
+        for (int j = 0; j < W; j++)
+            if (lanes[j] < minValue) minValue = lanes[j];
+        V::Store(lanes, vMax);
+        for (int j = 0; j < W; j++)
+            if (lanes[j] > maxValue) maxValue = lanes[j];
+    }
+    for (; i < length; i++)
+    {
+        if (data[i] < minValue) minValue = data[i];
+        if (data[i] > maxValue) maxValue = data[i];
+    }
+}
+
+/// Fills a kernel table with the instantiations for `V`.
+template<typename V>
+PixelKernels MakePixelKernels(SimdLevel simdLevel)
+{
+    PixelKernels kernels{};
+    kernels.simdLevel = simdLevel;
+    kernels.blend = &Blend<V>;
+    kernels.blendAdaptive = &BlendAdaptive<V>;
+    kernels.clamp = &Clamp<V>;
+    kernels.interpolateLut = &InterpolateLut<V>;
+    kernels.multiply = &Multiply<V>;
+    kernels.affineClamp = &AffineClamp<V>;
+    kernels.findMinMax = &UpdateMinMax<V>;
+    return kernels;
+}
@@ -0,0 +1,294 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Element-wise operations implementation; scalar kernels and selection of the vectorized ones.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "pixel_kernels.h"
+#include "../../imppg_assert.h"
+
+// NOTE: MSVC 18 requires a signed integral type 'for' loop counter
+//       when using OpenMP
+
+/// Reference (non-vectorized) implementation of `PixelKernels::blend`.
+static void BlendScalar(const float input[], const float blurred[], float output[], int length, float amount)
+{
+    for (int i = 0; i < length; i++)
+        output[i] = blurred[i] + amount * (input[i] - blurred[i]);
+}
+
+/// Reference (non-vectorized) implementation of `PixelKernels::blendAdaptive`.
+static void BlendAdaptiveScalar(
+    const float input[], const float blurred[], const float steering[], float output[], int length,
+    const CubicTransition& amount)
+{
+    for (int i = 0; i < length; i++)
+        output[i] = blurred[i] + amount(steering[i]) * (input[i] - blurred[i]);
+}
+
+/// Reference (non-vectorized) implementation of `PixelKernels::clamp`; NaN becomes 'minValue'.
+static void ClampScalar(const float input[], float output[], int length, float minValue, float maxValue)
+{
+    for (int i = 0; i < length; i++)
+        output[i] = IsNaN(input[i]) ? minValue : std::clamp(input[i], minValue, maxValue);
+}
+
+/// Reference (non-vectorized) implementation of `PixelKernels::interpolateLut`.
+static void InterpolateLutScalar(
+    const float values[], const float slopes[], int numSegments, const float input[], float output[], int length)
+{
+    for (int i = 0; i < length; i++)
+    {
+        const float x = (input[i] > 0.0f ? std::min(input[i], 1.0f) : 0.0f) * numSegments;
+        const int segment = static_cast<int>(std::min(x, static_cast<float>(numSegments - 1)));
+        output[i] = values[segment] + (x - segment) * slopes[segment];
+    }
+}
+
+/// Reference (non-vectorized) implementation of `PixelKernels::multiply`.
+static void MultiplyScalar(float data[], const float factor[], int length)
+{
+    for (int i = 0; i < length; i++)
+        data[i] *= factor[i];
+}
+
+/// Reference (non-vectorized) implementation of `PixelKernels::affineClamp`; NaN becomes 'minValue'.
+static void AffineClampScalar(float data[], int length, float a, float b, float minValue, float maxValue)
+{
+    for (int i = 0; i < length; i++)
+    {
+        const float value = a * data[i] + b;
+        data[i] = IsNaN(value) ? minValue : std::clamp(value, minValue, maxValue);
+    }
+}
+
+/// Reference (non-vectorized) implementation of `PixelKernels::findMinMax`.
+static void UpdateMinMaxScalar(const float data[], int length, float& minValue, float& maxValue)
+{
+    for (int i = 0; i < length; i++)
+    {
+        minValue = std::min(minValue, data[i]);
+        maxValue = std::max(maxValue, data[i]);
+    }
+}
+
+const PixelKernels& GetScalarPixelKernels()
+{
+    static const PixelKernels kernels{
+        SimdLevel::SCALAR,
+        &BlendScalar,
+        &BlendAdaptiveScalar,
+        &ClampScalar,
+        &InterpolateLutScalar,
+        &MultiplyScalar,
+        &AffineClampScalar,
+        &UpdateMinMaxScalar
+    };
+    return kernels;
+}
+
+#ifndef NDEBUG
+/// Checks the results of vectorized kernels against the scalar ones.
+static void VerifyPixelKernels(const PixelKernels& kernels)
+{
+    const PixelKernels& reference = GetScalarPixelKernels();
+
+    const auto isClose = [](float expected, float actual) { return std::abs(expected - actual) <= 1.0e-5f * std::abs(expected) + 1.0e-6f; };
+
+    // Values from [-0.5; 1.5], lengths which are not multiples of the vector width
+    for (int length: { 1, 7, 33, 150 })
+    {
+        std::vector<float> input(length), blurred(length), steering(length);
+        for (int i = 0; i < length; i++)
+        {
+            input[i] = static_cast<float>((i * 7919) % 113) / 56.5f - 0.5f;
+            blurred[i] = static_cast<float>((i * 6007) % 101) / 101.0f;
+            steering[i] = static_cast<float>(i % 17) / 16.0f;
+        }
+
+        std::vector<float> expected(length), actual(length);
+
+        reference.blend(input.data(), blurred.data(), expected.data(), length, 2.5f);
+        kernels.blend(input.data(), blurred.data(), actual.data(), length, 2.5f);
+        for (int i = 0; i < length; i++)
+            IMPPG_ASSERT(isClose(expected[i], actual[i]));
+
+        const CubicTransition amount{ 0.25f, 0.75f, 1.0f, 3.0f, -16.0f, 24.0f, -9.0f, 2.0f };
+        reference.blendAdaptive(input.data(), blurred.data(), steering.data(), expected.data(), length, amount);
+        kernels.blendAdaptive(input.data(), blurred.data(), steering.data(), actual.data(), length, amount);
+        for (int i = 0; i < length; i++)
+            IMPPG_ASSERT(isClose(expected[i], actual[i]));
+
+        // NaN must become the minimum both in the vectorized loops and in the remainder loops
+        std::vector<float> inputWithNaN = input;
+        for (int i = 0; i < length; i += 3)
+            inputWithNaN[i] = std::numeric_limits<float>::quiet_NaN();
+
+        reference.clamp(inputWithNaN.data(), expected.data(), length, 0.0f, 1.0f);
+        kernels.clamp(inputWithNaN.data(), actual.data(), length, 0.0f, 1.0f);
+        IMPPG_ASSERT(expected == actual && expected[0] == 0.0f);
+
+        constexpr int NUM_SEGMENTS = 16;
+        std::vector<float> lutValues(NUM_SEGMENTS), lutSlopes(NUM_SEGMENTS);
+        for (int i = 0; i < NUM_SEGMENTS; i++)
+        {
+            lutValues[i] = std::sqrt(static_cast<float>(i) / NUM_SEGMENTS);
+            lutSlopes[i] = std::sqrt(static_cast<float>(i + 1) / NUM_SEGMENTS) - lutValues[i];
+        }
+        reference.interpolateLut(lutValues.data(), lutSlopes.data(), NUM_SEGMENTS, input.data(), expected.data(), length);
+        kernels.interpolateLut(lutValues.data(), lutSlopes.data(), NUM_SEGMENTS, input.data(), actual.data(), length);
+        for (int i = 0; i < length; i++)
+            IMPPG_ASSERT(isClose(expected[i], actual[i]));
+
+        expected = input;
+        actual = input;
+        reference.multiply(expected.data(), blurred.data(), length);
+        kernels.multiply(actual.data(), blurred.data(), length);
+        for (int i = 0; i < length; i++)
+            IMPPG_ASSERT(isClose(expected[i], actual[i]));
+
+        expected = inputWithNaN;
+        actual = inputWithNaN;
+        reference.affineClamp(expected.data(), length, 1.7f, -0.2f, 0.0f, 1.0f);
+        kernels.affineClamp(actual.data(), length, 1.7f, -0.2f, 0.0f, 1.0f);
+        for (int i = 0; i < length; i++)
+            IMPPG_ASSERT(isClose(expected[i], actual[i]));
+        IMPPG_ASSERT(expected[0] == 0.0f);
+
+        float expectedMin = input[0], expectedMax = input[0], actualMin = input[0], actualMax = input[0];
+        reference.findMinMax(input.data(), length, expectedMin, expectedMax);
+        kernels.findMinMax(input.data(), length, actualMin, actualMax);
+        IMPPG_ASSERT(expectedMin == actualMin && expectedMax == actualMax);
+    }
+}
+#endif
+
+static const PixelKernels& SelectPixelKernels()
+{
+    const PixelKernels* kernels = &GetScalarPixelKernels();
+
+#if IMPPG_X86_SIMD
+    switch (GetSimdLevel())
+    {
+    case SimdLevel::AVX512: kernels = &GetAVX512PixelKernels(); break;
+    case SimdLevel::AVX2:   kernels = &GetAVX2PixelKernels(); break;
+    case SimdLevel::SSE4:   kernels = &GetSSE4PixelKernels(); break;
+    default: break;
+    }
+#endif
+
+#ifndef NDEBUG
+    VerifyPixelKernels(*kernels);
+#endif
+
+    return *kernels;
+}
+
+const PixelKernels& GetPixelKernels()
+{
+    static const PixelKernels& kernels = SelectPixelKernels();
+    return kernels;
+}
+
+void BlendRow(const float input[], const float blurred[], float output[], int length, float amount)
+{
+    GetPixelKernels().blend(input, blurred, output, length, amount);
+}
+
+void BlendRowAdaptive(
+    const float input[],
+    const float blurred[],
+    const float steering[],
+    float output[],
+    int length,
+    const CubicTransition& amount
+)
+{
+    GetPixelKernels().blendAdaptive(input, blurred, steering, output, length, amount);
+}
+
+void ClampRow(const float input[], float output[], int length, float minValue, float maxValue)
+{
+    GetPixelKernels().clamp(input, output, length, minValue, maxValue);
+}
+
+void InterpolateLutRow(const float values[], const float slopes[], int numSegments, const float input[], float output[], int length)
+{
+    GetPixelKernels().interpolateLut(values, slopes, numSegments, input, output, length);
+}
+
+void ClampArray(c_PaddedArrayPtr<float> data, float minValue, float maxValue)
+{
+    const PixelKernels& kernels = GetPixelKernels();
+
+    #pragma omp parallel for
+    for (int row = 0; row < data.height(); row++)
+        kernels.clamp(data.row(row), data.row(row), data.width(), minValue, maxValue);
+}
+
+void MultiplyArrays(c_PaddedArrayPtr<float> data, c_PaddedArrayPtr<const float> factor)
+{
+    IMPPG_ASSERT(data.width() == factor.width() && data.height() == factor.height());
+    const PixelKernels& kernels = GetPixelKernels();
+
+    #pragma omp parallel for
+    for (int row = 0; row < data.height(); row++)
+        kernels.multiply(data.row(row), factor.row_const(row), data.width());
+}
+
+void AffineTransformArray(c_PaddedArrayPtr<float> data, float a, float b, float minValue, float maxValue)
+{
+    const PixelKernels& kernels = GetPixelKernels();
+
+    #pragma omp parallel for
+    for (int row = 0; row < data.height(); row++)
+        kernels.affineClamp(data.row(row), data.width(), a, b, minValue, maxValue);
+}
+
+std::pair<float, float> FindMinMax(c_PaddedArrayPtr<const float> data)
+{
+    IMPPG_ASSERT(data.width() > 0 && data.height() > 0);
+    const PixelKernels& kernels = GetPixelKernels();
+
+    float minValue = data.row_const(0)[0];
+    float maxValue = minValue;
+
+    #pragma omp parallel
+    {
+        float threadMin = minValue, threadMax = maxValue;
+
+        #pragma omp for nowait
+        for (int row = 0; row < data.height(); row++)
+            kernels.findMinMax(data.row_const(row), data.width(), threadMin, threadMax);
+
+        #pragma omp critical
+        {
+            minValue = std::min(minValue, threadMin);
+            maxValue = std::max(maxValue, threadMax);
+        }
+    }
+
+    return { minValue, maxValue };
+}
@@ -0,0 +1,174 @@
+/*
+ImPPG (Image Post-Processor) - common operations for astronomical stacks and other images
+Copyright (C) 2022 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of ImPPG.
+
+ImPPG is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ImPPG is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ImPPG.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Thin wrappers of SIMD intrinsics used by the vectorized kernels.
+
+    Include only from a translation unit compiled for the corresponding instruction set,
+    after defining one of: IMPPG_SIMD_SSE4, IMPPG_SIMD_AVX2, IMPPG_SIMD_AVX512.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/// Returns `ptr` offset by `bytes`.
+template<typename T>
+static T* OffsetBytes(T* ptr, std::ptrdiff_t bytes)
+{
+    using Byte = std::conditional_t<std::is_const_v<T>, const std::uint8_t, std::uint8_t>;
+    return reinterpret_cast<T*>(reinterpret_cast<Byte*>(ptr) + bytes);
+}
+
+#if defined(IMPPG_SIMD_SSE4)
+
+#include <smmintrin.h>
+
+struct VecSSE4
+{
+    using Reg = __m128;
+    static constexpr int WIDTH = 4;
+
+    static Reg Load(const float* ptr) { return _mm_loadu_ps(ptr); }
+    static void Store(float* ptr, Reg v) { _mm_storeu_ps(ptr, v); }
+    static Reg Set1(float value) { return _mm_set1_ps(value); }
+    static Reg Zero() { return _mm_setzero_ps(); }
+    static Reg Add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+    static Reg Sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+    static Reg Mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+    static Reg Div(Reg a, Reg b) { return _mm_div_ps(a, b); }
+    /// Returns a*b + c.
+    static Reg MulAdd(Reg a, Reg b, Reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static Reg Min(Reg a, Reg b) { return _mm_min_ps(a, b); }
+    static Reg Max(Reg a, Reg b) { return _mm_max_ps(a, b); }
+
+    using Mask = __m128;
+    /// Returns a mask of the lanes where a < b.
+    static Mask Less(Reg a, Reg b) { return _mm_cmplt_ps(a, b); }
+    /// Returns a mask of the lanes containing NaN (compares the bits, so it works also with -ffast-math).
+    static Mask IsNaN(Reg v)
+    {
+        const __m128i absBits = _mm_and_si128(_mm_castps_si128(v), _mm_set1_epi32(0x7FFFFFFF));
+        return _mm_castsi128_ps(_mm_cmpgt_epi32(absBits, _mm_set1_epi32(0x7F800000)));
+    }
+    /// Returns `ifTrue` in the lanes set in `mask` and `ifFalse` in the others.
+    static Reg Select(Mask mask, Reg ifTrue, Reg ifFalse) { return _mm_blendv_ps(ifFalse, ifTrue, mask); }
+
+    using IntReg = __m128i;
+    /// Converts to integers, rounding towards zero.
+    static IntReg Truncate(Reg v) { return _mm_cvttps_epi32(v); }
+    static Reg ToFloat(IntReg v) { return _mm_cvtepi32_ps(v); }
+    /// Returns base[indices[i]] in each lane i.
+    static Reg Gather(const float* base, IntReg indices)
+    {
+        return _mm_setr_ps(
+            base[_mm_extract_epi32(indices, 0)], base[_mm_extract_epi32(indices, 1)],
+            base[_mm_extract_epi32(indices, 2)], base[_mm_extract_epi32(indices, 3)]);
+    }
+};
+
+#elif defined(IMPPG_SIMD_AVX2)
+
+#include <immintrin.h>
+
+struct VecAVX2
+{
+    using Reg = __m256;
+    static constexpr int WIDTH = 8;
+
+    static Reg Load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+    static void Store(float* ptr, Reg v) { _mm256_storeu_ps(ptr, v); }
+    static Reg Set1(float value) { return _mm256_set1_ps(value); }
+    static Reg Zero() { return _mm256_setzero_ps(); }
+    static Reg Add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+    static Reg Sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+    static Reg Mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+    static Reg Div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+    /// Returns a*b + c.
+    static Reg MulAdd(Reg a, Reg b, Reg c) { return _mm256_fmadd_ps(a, b, c); }
+    static Reg Min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+    static Reg Max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+
+    using Mask = __m256;
+    /// Returns a mask of the lanes where a < b.
+    static Mask Less(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    /// Returns a mask of the lanes containing NaN (compares the bits, so it works also with -ffast-math).
+    static Mask IsNaN(Reg v)
+    {
+        const __m256i absBits = _mm256_and_si256(_mm256_castps_si256(v), _mm256_set1_epi32(0x7FFFFFFF));
+        return _mm256_castsi256_ps(_mm256_cmpgt_epi32(absBits, _mm256_set1_epi32(0x7F800000)));
+    }
+    /// Returns `ifTrue` in the lanes set in `mask` and `ifFalse` in the others.
+    static Reg Select(Mask mask, Reg ifTrue, Reg ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, mask); }
+
+    using IntReg = __m256i;
+    /// Converts to integers, rounding towards zero.
+    static IntReg Truncate(Reg v) { return _mm256_cvttps_epi32(v); }
+    static Reg ToFloat(IntReg v) { return _mm256_cvtepi32_ps(v); }
+    /// Returns base[indices[i]] in each lane i.
+    static Reg Gather(const float* base, IntReg indices) { return _mm256_i32gather_ps(base, indices, sizeof(float)); }
+};
+
+#elif defined(IMPPG_SIMD_AVX512)
+
+#include <immintrin.h>
+
+struct VecAVX512
+{
+    using Reg = __m512;
+    static constexpr int WIDTH = 16;
+
+    static Reg Load(const float* ptr) { return _mm512_loadu_ps(ptr); }
+    static void Store(float* ptr, Reg v) { _mm512_storeu_ps(ptr, v); }
+    static Reg Set1(float value) { return _mm512_set1_ps(value); }
+    static Reg Zero() { return _mm512_setzero_ps(); }
+    static Reg Add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+    static Reg Sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+    static Reg Mul(Reg a, Reg b) { return _mm512_mul_ps(a, b); }
+    static Reg Div(Reg a, Reg b) { return _mm512_div_ps(a, b); }
+    /// Returns a*b + c.
+    static Reg MulAdd(Reg a, Reg b, Reg c) { return _mm512_fmadd_ps(a, b, c); }
+    static Reg Min(Reg a, Reg b) { return _mm512_min_ps(a, b); }
+    static Reg Max(Reg a, Reg b) { return _mm512_max_ps(a, b); }
+
+    using Mask = __mmask16;
+    /// Returns a mask of the lanes where a < b.
+    static Mask Less(Reg a, Reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    /// Returns a mask of the lanes containing NaN (compares the bits, so it works also with -ffast-math).
+    static Mask IsNaN(Reg v)
+    {
+        const __m512i absBits = _mm512_and_si512(_mm512_castps_si512(v), _mm512_set1_epi32(0x7FFFFFFF));
+        return _mm512_cmpgt_epi32_mask(absBits, _mm512_set1_epi32(0x7F800000));
+    }
+    /// Returns `ifTrue` in the lanes set in `mask` and `ifFalse` in the others.
+    static Reg Select(Mask mask, Reg ifTrue, Reg ifFalse) { return _mm512_mask_blend_ps(mask, ifFalse, ifTrue); }
+
+    using IntReg = __m512i;
+    /// Converts to integers, rounding towards zero.
+    static IntReg Truncate(Reg v) { return _mm512_cvttps_epi32(v); }
+    static Reg ToFloat(IntReg v) { return _mm512_cvtepi32_ps(v); }
+    /// Returns base[indices[i]] in each lane i.
+    static Reg Gather(const float* base, IntReg indices) { return _mm512_i32gather_ps(indices, base, sizeof(float)); }
+};
+
+#else
+#error "Define the instruction set (IMPPG_SIMD_*) before including simd.h."
+#endif
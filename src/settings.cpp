@@ -22,6 +22,7 @@ File description:
 */
 
 #include <sstream>
+#include <string>
 #include <wx/xml/xml.h>
 
 #include "num_formatter.h"
@@ -29,6 +30,7 @@ File description:
 
 const int XML_INDENT = 4;
 const unsigned FLOAT_PREC = 4;
+const unsigned CONVERGENCE_TOLERANCE_PREC = 8;
 
 /// Names of XML elements in a settings file
 namespace XmlName
@@ -39,6 +41,11 @@ namespace XmlName
     const char* lrSigma = "sigma";
     const char* lrIters = "iterations";
     const char* lrDeringing = "deringing";
+    const char* lrAccelerated = "accelerated";
+    const char* lrStopOnConvergence = "stop_on_convergence";
+    const char* lrConvergenceTolerance = "convergence_tolerance";
+    const char* lrMeasuredPsf = "measured_psf";
+    const char* lrPsfFile = "psf_file";
 
     const char* unshMask = "unsharp_mask";
     const char* unshAdaptive = "adaptive";
@@ -88,12 +95,26 @@ wxXmlNode* CreateToneCurveSettingsNode(const c_ToneCurve& toneCurve)
     return result;
 }
 
-wxXmlNode* CreateLucyRichardsonSettingsNode(float lrSigma, int lrIters, bool lrDeringing)
+wxXmlNode* CreateLucyRichardsonSettingsNode(
+    float lrSigma,
+    int lrIters,
+    bool lrDeringing,
+    bool lrAccelerated,
+    bool lrStopOnConvergence,
+    float lrConvergenceTolerance,
+    bool lrMeasuredPsf,
+    const std::string& lrPsfFile
+)
 {
     wxXmlNode* result = new wxXmlNode(wxXML_ELEMENT_NODE, XmlName::lucyRichardson);
     result->AddAttribute(XmlName::lrSigma, NumFormatter::Format(lrSigma, FLOAT_PREC));
     result->AddAttribute(XmlName::lrIters, wxString::Format("%d", lrIters));
     result->AddAttribute(XmlName::lrDeringing, lrDeringing ? trueStr : falseStr);
+    result->AddAttribute(XmlName::lrAccelerated, lrAccelerated ? trueStr : falseStr);
+    result->AddAttribute(XmlName::lrStopOnConvergence, lrStopOnConvergence ? trueStr : falseStr);
+    result->AddAttribute(XmlName::lrConvergenceTolerance, NumFormatter::Format(lrConvergenceTolerance, CONVERGENCE_TOLERANCE_PREC));
+    result->AddAttribute(XmlName::lrMeasuredPsf, lrMeasuredPsf ? trueStr : falseStr);
+    result->AddAttribute(XmlName::lrPsfFile, wxString::FromUTF8(lrPsfFile));
     return result;
 }
 
@@ -126,7 +147,12 @@ bool SaveSettings(wxString filePath, const ProcessingSettings& settings)
     root->AddChild(CreateLucyRichardsonSettingsNode(
         settings.LucyRichardson.sigma,
         settings.LucyRichardson.iterations,
-        settings.LucyRichardson.deringing.enabled
+        settings.LucyRichardson.deringing.enabled,
+        settings.LucyRichardson.accelerated,
+        settings.LucyRichardson.convergenceStop.enabled,
+        settings.LucyRichardson.convergenceStop.tolerance,
+        settings.LucyRichardson.measuredPsf.enabled,
+        settings.LucyRichardson.measuredPsf.fileName
     ));
     root->AddChild(CreateUnsharpMaskingSettingsNode(
         settings.unsharpMasking.adaptive,
@@ -146,7 +172,17 @@ bool SaveSettings(wxString filePath, const ProcessingSettings& settings)
     return CreateAndSaveDocument(filePath, root);
 }
 
-bool ParseLucyRichardsonSettings(const wxXmlNode* node, float& sigma, int& iterations, bool& deringing)
+bool ParseLucyRichardsonSettings(
+    const wxXmlNode* node,
+    float& sigma,
+    int& iterations,
+    bool& deringing,
+    bool& accelerated,
+    bool& stopOnConvergence,
+    float& convergenceTolerance,
+    bool& measuredPsf,
+    std::string& psfFile
+)
 {
     if (!NumFormatter::Parse(node->GetAttribute(XmlName::lrSigma), sigma))
     {
@@ -170,6 +206,36 @@ bool ParseLucyRichardsonSettings(const wxXmlNode* node, float& sigma, int& itera
     else
         return false;
 
+    // Optional (absent in files saved by older versions)
+    if (node->GetAttribute(XmlName::lrAccelerated) == trueStr)
+        accelerated = true;
+    else if (node->GetAttribute(XmlName::lrAccelerated, falseStr) == falseStr)
+        accelerated = false;
+    else
+        return false;
+
+    if (node->GetAttribute(XmlName::lrStopOnConvergence) == trueStr)
+        stopOnConvergence = true;
+    else if (node->GetAttribute(XmlName::lrStopOnConvergence, falseStr) == falseStr)
+        stopOnConvergence = false;
+    else
+        return false;
+
+    if (node->HasAttribute(XmlName::lrConvergenceTolerance) &&
+        (!NumFormatter::Parse(node->GetAttribute(XmlName::lrConvergenceTolerance), convergenceTolerance) || convergenceTolerance < 0.0f))
+    {
+        return false;
+    }
+
+    if (node->GetAttribute(XmlName::lrMeasuredPsf) == trueStr)
+        measuredPsf = true;
+    else if (node->GetAttribute(XmlName::lrMeasuredPsf, falseStr) == falseStr)
+        measuredPsf = false;
+    else
+        return false;
+
+    psfFile = node->GetAttribute(XmlName::lrPsfFile).ToUTF8();
+
     return true;
 }
 
@@ -320,13 +386,23 @@ bool LoadSettings(
             float sigma;
             int iters;
             bool deringing;
+            bool accelerated;
+            bool stopOnConvergence;
+            float convergenceTolerance = settings.LucyRichardson.convergenceStop.tolerance;
+            bool measuredPsf;
+            std::string psfFile;
 
-            if (!ParseLucyRichardsonSettings(child, sigma, iters, deringing))
+            if (!ParseLucyRichardsonSettings(child, sigma, iters, deringing, accelerated, stopOnConvergence, convergenceTolerance, measuredPsf, psfFile))
                 return false;
 
             settings.LucyRichardson.sigma = sigma;
             settings.LucyRichardson.iterations = iters;
             settings.LucyRichardson.deringing.enabled = deringing;
+            settings.LucyRichardson.accelerated = accelerated;
+            settings.LucyRichardson.convergenceStop.enabled = stopOnConvergence;
+            settings.LucyRichardson.convergenceStop.tolerance = convergenceTolerance;
+            settings.LucyRichardson.measuredPsf.enabled = measuredPsf;
+            settings.LucyRichardson.measuredPsf.fileName = psfFile;
 
             if (loadedLR)
                 *loadedLR = true;
@@ -30,6 +30,7 @@ File description:
 #endif
 
 #include "wxapp.h"
+#include "adv_settings_wnd.h"
 #include "appconfig.h"
 #include "cursors.h"
 #include "logging.h"
@@ -95,9 +96,17 @@ bool c_MyApp::OnInit()
     m_Locale.AddCatalog("wxstd3"); ///< The wxWidgets catalog (translated captions of standard menu items like "Open", control buttons like "Browse" etc.)
     m_Locale.AddCatalog("imppg");
 
+    const auto hasArg = [this](const char* arg)
+    {
+        for (int i = 1; i < argc; i++)
+            if (argv[i] == arg)
+                return true;
+        return false;
+    };
+
     // Initialize internal logging
     m_LogStream = 0;
-    if (argc > 1 && argv[1] == "--log")
+    if (hasArg("--log"))
     {
         wxFileName logFilePath(wxFileName::GetHomeDir(), "imppg", "log");
         m_LogStream = new std::ofstream(logFilePath.GetFullPath().ToStdString().c_str(), std::ios_base::out | std::ios_base::app);
@@ -105,6 +114,10 @@ bool c_MyApp::OnInit()
         Log::Print(wxString("\n") + wxDateTime::Now().FormatISOCombined(' ') + " ------------ IMPPG STARTED ------------\n\n", false);
     }
 
+    // Measurements of which convolution method is faster for which Gaussian sigma are performed
+    // when first needed (once, unless requested) and stored on exit
+    InitConvolutionCalibration(hasArg("--calibrate-convolution"));
+
     Cursors::InitCursors();
     wxToolTip::Enable(true);
     c_MainWindow* mainWnd = new c_MainWindow();
@@ -120,6 +133,8 @@ bool c_MyApp::OnInit()
 
 int c_MyApp::OnExit()
 {
+    StoreConvolutionCalibration();
+
     if (m_LogStream)
     {
         Log::Print("Exiting\n");